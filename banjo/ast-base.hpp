@@ -15,6 +15,8 @@
 #include <lingo/token.hpp>
 
 #include <forward_list>
+#include <typeindex>
+#include <unordered_map>
 #include <vector>
 #include <utility>
 
@@ -95,6 +97,19 @@ struct Allocator
 
 
 
+// The number of objects of a dynamic type that have been allocated,
+// and the total number of bytes allocated for them.
+struct Allocation_record
+{
+  std::size_t count = 0;
+  std::size_t bytes = 0;
+};
+
+
+// Maps dynamic types to their allocation statistics.
+using Allocation_stats = std::unordered_map<std::type_index, Allocation_record>;
+
+
 // A simple data-retaining allocator that releases all memory when it goes 
 // out of scope. Explicit deallocation has no behavior.
 //
@@ -113,6 +128,12 @@ struct List_allocator : Allocator
   void* allocate(std::size_t n, std::type_info const& ti)
   {
     list.emplace_front(n);
+    bytes += n;
+    if (counting) {
+      Allocation_record& r = stats[ti];
+      ++r.count;
+      r.bytes += n;
+    }
     return list.front().buf;
   }
   
@@ -121,7 +142,19 @@ struct List_allocator : Allocator
     // Never explicitly deallocate memory.
   }
 
+  // Returns the total number of bytes allocated. Because memory is
+  // never released, this is also the peak size of the arena.
+  std::size_t allocated() const { return bytes; }
+
+  // When enabled, allocations are counted by dynamic type.
+  bool count_allocations() const  { return counting; }
+  void count_allocations(bool b)  { counting = b; }
+  Allocation_stats const& allocation_stats() const { return stats; }
+
   std::forward_list<Block> list;
+  std::size_t              bytes = 0;
+  bool                     counting = false;
+  Allocation_stats         stats;
 };
 
 
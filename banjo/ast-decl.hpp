@@ -42,6 +42,7 @@ enum Specifier_set : int
   mutable_spec   = 1 << 14,
   forward_spec   = 1 << 15,
   meta_spec      = 1 << 16,
+  extern_spec    = 1 << 18, // Defined in another translation unit
   
   internal_spec  = 1 << 31, // Internal to the language
 };
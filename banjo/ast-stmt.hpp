@@ -202,6 +202,16 @@ struct If_else_stmt : Stmt, Allocatable<If_else_stmt>
 };
 
 
+// Optimization hints attached to a loop. These are passed through to
+// the code generator as loop metadata. A value of 0 means that no hint
+// was given.
+struct Loop_hints
+{
+  int vectorize = 0; // The vectorization width
+  int unroll = 0;    // The unroll count
+};
+
+
 // A while statement.
 struct While_stmt : Stmt, Allocatable<While_stmt>
 {
@@ -209,6 +219,10 @@ struct While_stmt : Stmt, Allocatable<While_stmt>
     : cond_(&e), body_(&s)
   { }
 
+  While_stmt(Expr& e, Stmt& s, Loop_hints const& h)
+    : cond_(&e), body_(&s), hints_(h)
+  { }
+
   void accept(Visitor& v) const { v.visit(*this); }
   void accept(Mutator& v)       { v.visit(*this); }
 
@@ -218,8 +232,11 @@ struct While_stmt : Stmt, Allocatable<While_stmt>
   Stmt const& body() const { return *body_; }
   Stmt&       body()       { return *body_; }
 
-  Expr* cond_;
-  Stmt* body_;
+  Loop_hints const& hints() const { return hints_; }
+
+  Expr*      cond_;
+  Stmt*      body_;
+  Loop_hints hints_;
 };
 
 
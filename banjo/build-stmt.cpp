@@ -86,6 +86,13 @@ Builder::make_while_statement(Expr& e, Stmt& s)
 }
 
 
+While_stmt&
+Builder::make_while_statement(Expr& e, Stmt& s, Loop_hints const& h)
+{
+  return While_stmt::make(alloc_, e, s, h);
+}
+
+
 Break_stmt&
 Builder::make_break_statement()
 {
@@ -176,6 +176,7 @@ struct Builder
   If_then_stmt&      make_if_statement(Expr&, Stmt&);
   If_else_stmt&      make_if_statement(Expr&, Stmt&, Stmt&);
   While_stmt&        make_while_statement(Expr&, Stmt&);
+  While_stmt&        make_while_statement(Expr&, Stmt&, Loop_hints const&);
   Break_stmt&        make_break_statement();
   Continue_stmt&     make_continue_statement();
   Expression_stmt&   make_expression_statement(Expr&);
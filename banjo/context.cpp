@@ -6,6 +6,7 @@
 #include "scope.hpp"
 #include "declaration.hpp"
 #include "debugging.hpp"
+#include "serialization.hpp"
 
 #include <lingo/io.hpp>
 
@@ -20,8 +21,11 @@ Context::Context(Symbol_table& s)
   , Builder(*this, s)
   , syms_(s)
   , scope(nullptr)
+  , profiling(false)
+  , engine(*this)
   , id(0)
   , diags(false)
+  , failure(nullptr)
 {
   // Initialize the color system. This is a process-level configuration. 
   // Perhaps we we should only initialize colors if the default output 
@@ -33,6 +37,10 @@ Context::Context(Symbol_table& s)
 }
 
 
+Context::~Context()
+{ }
+
+
 Translation_unit const&
 Context::translation_unit() const
 {
@@ -87,16 +95,49 @@ Context::leave_context()
 }
 
 
+// Open the binary AST file at the given path for import. Returns
+// false, after diagnosing the error, if the file cannot be read.
+bool
+Context::import(String const& path)
+{
+  std::unique_ptr<Ast_reader> r(new Ast_reader(*this, path));
+  if (!*r)
+    return false;
+  imports.push_back(std::move(r));
+  return true;
+}
+
+
+// Import the declarations of the name from each imported translation
+// unit and declare them in the global scope. Declarations are imported
+// on demand, when lookup does not find the name in the program, so
+// that unused declarations are never read. Returns the declarations
+// found, if any.
+Decl_list
+Context::lookup_imports(Name const& n)
+{
+  Simple_id const* id = as<Simple_id>(&n);
+  if (!id || imports.empty())
+    return {};
+  for (std::unique_ptr<Ast_reader>& r : imports) {
+    for (Decl& d : r->lookup(id->symbol().spelling())) {
+      declare(*this, global_scope(), d);
+      imported.push_back(d);
+    }
+  }
+  if (Overload_set* ovl = global_scope().lookup(n))
+    return *ovl;
+  return {};
+}
+
+
 // FIXME: We should probably do better for a default implementation.
 
 void
 Context::emit_error(Message const& m)
 {
   if (!diags) return;
-  
-  std::cerr << "error: " << input << ": ";
-  dump(std::cerr, m);
-  std::cerr << '\n';
+  diagnostics_.emit(error_level, input, m);
 }
 
 
@@ -104,10 +145,7 @@ void
 Context::emit_warning(Message const& m)
 {
   if (!diags) return;
-
-  std::cerr << "warning: " << input << ": ";
-  dump(std::cerr, m);
-  std::cerr << '\n';
+  diagnostics_.emit(warning_level, input, m);
 }
 
 
@@ -7,16 +7,21 @@
 #include "builder.hpp"
 #include "builtin.hpp"
 #include "error.hpp"
+#include "query.hpp"
 #include "scope.hpp"
+#include "timing.hpp"
 #include "value.hpp"
 
 #include <lingo/environment.hpp>
 
+#include <memory>
+
 
 namespace banjo
 {
 
 struct Builtins;
+struct Ast_reader;
 
 
 // Used to associate scopes with terms: the translation unit, classes,
@@ -37,6 +42,41 @@ using Store = lingo::Environment<Decl const*, Value>;
 using Call_map = std::unordered_map<Type*, Decl*, Type_hash, Type_eq>;
 
 
+// Limits on the compile-time evaluation of expressions. A limit of 0
+// means that evaluation is unbounded in that respect.
+struct Evaluation_limits
+{
+  std::size_t steps = 1 << 20; // Maximum number of evaluation steps
+  std::size_t depth = 1024;    // Maximum nesting of evaluation steps
+};
+
+
+// Accumulated statistics for the compile-time evaluation of a
+// declaration (e.g., a meta function or a constant). Steps and times
+// are inclusive of nested evaluations.
+struct Evaluation_record
+{
+  std::size_t calls = 0; // Number of evaluations
+  std::size_t steps = 0; // Number of evaluation steps
+  double      time  = 0; // Wall time, in seconds
+};
+
+
+// Readers of imported translation units.
+using Import_list = std::vector<std::unique_ptr<Ast_reader>>;
+
+
+// Maps declarations to their evaluation statistics.
+using Evaluation_profile = std::unordered_map<Decl const*, Evaluation_record>;
+
+
+// Controls the layout of class objects in generated code.
+struct Layout_options
+{
+  bool stats = false; // Report the size and padding of each class
+};
+
+
 // A repository of information to support translation.
 //
 // TODO: Choose a better default allocator for the context.
@@ -45,6 +85,7 @@ using Call_map = std::unordered_map<Type*, Decl*, Type_hash, Type_eq>;
 struct Context : List_allocator, Builder
 {
   Context(Symbol_table&);
+  ~Context();
 
   // Non-copyable
   Context(Context const&) = delete;
@@ -91,6 +132,11 @@ struct Context : List_allocator, Builder
   // Synthesis
   Decl& synthesize_call_operator(Function_decl&);
 
+  // Imported translation units
+  bool import(String const&);
+  Decl_list lookup_imports(Name const&);
+  Decl_list const& imported_declarations() const { return imported; }
+
   // Constant value store
   Store const& constants() const { return values; }
   Store&       constants()       { return values; }
@@ -98,6 +144,25 @@ struct Context : List_allocator, Builder
   void store(Decl&, Value const&);
   Value const& load(Decl&);
 
+  // Compile-time evaluation
+  Evaluation_limits const&  evaluation_limits() const  { return limits; }
+  Evaluation_limits&        evaluation_limits()        { return limits; }
+  Evaluation_profile const& evaluation_profile() const { return profile; }
+  Evaluation_profile&       evaluation_profile()       { return profile; }
+  bool profile_evaluation() const { return profiling; }
+  void profile_evaluation(bool b) { profiling = b; }
+
+  // Code generation
+  Layout_options const& layout_options() const { return layout; }
+  Layout_options&       layout_options()       { return layout; }
+
+  // Semantic queries
+  Query_engine const& queries() const { return engine; }
+  Query_engine&       queries()       { return engine; }
+
+  // Instrumentation
+  Time_trace& time_trace() { return trace; }
+
   // Diagnostics
   //
   // TODO: Parameterize the context with a diagnostics manager that will 
@@ -112,6 +177,10 @@ struct Context : List_allocator, Builder
   // Making these virtual doesn't provide the level of generality that
   // we really want.
   bool diagnose_errors() const { return diags; }
+  Diagnostics const& diagnostics() const { return diagnostics_; }
+  Diagnostics&       diagnostics()       { return diagnostics_; }
+  char const* last_failure() const { return failure; }
+  void record_failure(char const* s) { failure = s; }
   virtual void emit_error(Message const& m);
   virtual void emit_warning(Message const& m);
   virtual void emit_info(Message const& m);
@@ -128,11 +197,31 @@ struct Context : List_allocator, Builder
   // Constant value store.
   Store         values;
 
+  // Imported translation units.
+  Import_list imports;  // Readers of imported files
+  Decl_list   imported; // Declarations imported so far
+
+  // Compile-time evaluation state.
+  Evaluation_limits  limits;    // Limits on evaluation
+  Evaluation_profile profile;   // Evaluation statistics
+  bool               profiling; // True if statistics are collected
+
+  // Code generation options.
+  Layout_options layout;
+
+  // Spans of translation time.
+  Time_trace trace;
+
+  // Memoized results of semantic queries.
+  Query_engine engine;
+
   // Store information for generating unique names.
   int             id;     // The current id counter
 
   // Diagnostic state
-  bool diags; // True if diagnostics should be emitted.
+  bool        diags;        // True if diagnostics should be emitted.
+  char const* failure;      // The most recent suppressed error
+  Diagnostics diagnostics_; // Issued diagnostics
 
   // Built-in entity definitions.
   Builtins builtins_;
@@ -332,11 +421,17 @@ using lingo::warning;
 using lingo::note;
 
 
-// Emit a formatted message at the current input position.
+// Emit a formatted message at the current input position. When
+// diagnostics are suppressed, no message is built; the format string
+// is recorded as the reason for the failure.
 template<typename... Args>
 inline void
 error(Context& cxt, char const* msg, Args const&... args)
 {
+  if (!cxt.diagnose_errors()) {
+    cxt.record_failure(msg);
+    return;
+  }
   Message m(msg, args...);
   cxt.emit_error(m);
 }
@@ -347,6 +442,8 @@ template<typename... Args>
 inline void
 warning(Context& cxt, char const* msg, Args const&... args)
 {
+  if (!cxt.diagnose_errors())
+    return;
   Message m(msg, args...);
   cxt.emit_warning(m);
 }
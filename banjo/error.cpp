@@ -6,6 +6,7 @@
 
 #include <lingo/io.hpp>
 
+#include <cstring>
 #include <iostream>
 #include <sstream>
 
@@ -33,8 +34,8 @@ void
 Message::render(std::ostream& os, Render_fn fn) const
 {
   auto iter = args_.begin();
-  char const* f = fmt_.data();
-  char const* l = f + fmt_.size();
+  char const* f = fmt_;
+  char const* l = f + std::strlen(fmt_);
   while (f != l) {
     if (is_placeholder(f, l)) {
       if (iter == args_.end())
@@ -104,6 +105,88 @@ dump(Message const& m)
 }
 
 
+// -------------------------------------------------------------------------- //
+// Diagnostics
+
+// Flush any deferred diagnostics.
+Diagnostics::~Diagnostics()
+{
+  flush(std::cerr);
+}
+
+
+// Record the diagnostic. Unless diagnostics are deferred, it is printed
+// immediately.
+void
+Diagnostics::emit(Diagnostic_level l, Location loc, Message const& m)
+{
+  Diagnostic_record rec {l, loc, m};
+  if (deferred)
+    records.push_back(std::move(rec));
+  else
+    render(std::cerr, rec);
+}
+
+
+// Print and discard all deferred diagnostics.
+void
+Diagnostics::flush(std::ostream& os)
+{
+  for (Diagnostic_record const& rec : records)
+    render(os, rec);
+  records.clear();
+}
+
+
+static char const*
+get_level_name(Diagnostic_level l)
+{
+  switch (l) {
+    case error_level: return "error";
+    case warning_level: return "warning";
+    case note_level: return "note";
+  }
+  lingo_unreachable();
+}
+
+
+// Write s as a JSON string.
+static void
+quote(std::ostream& os, String const& s)
+{
+  os << '"';
+  for (char c : s) {
+    if (c == '"' || c == '\\')
+      os << '\\';
+    if ((unsigned char)c >= ' ')
+      os << c;
+  }
+  os << '"';
+}
+
+
+// Render the diagnostic on a single line, as text or as a JSON object.
+void
+Diagnostics::render(std::ostream& os, Diagnostic_record const& rec)
+{
+  if (format == text_format) {
+    os << get_level_name(rec.level) << ": " << rec.loc << ": ";
+    dump(os, rec.msg);
+    os << '\n';
+    return;
+  }
+
+  std::stringstream loc, msg;
+  loc << rec.loc;
+  dump(msg, rec.msg);
+  os << "{\"level\":\"" << get_level_name(rec.level) << "\",\"location\":";
+  quote(os, loc.str());
+  os << ",\"message\":";
+  quote(os, msg.str());
+  os << "}\n";
+}
+
+
 // -------------------------------------------------------------------------- //
 // Exception formatting
 
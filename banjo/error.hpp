@@ -7,8 +7,8 @@
 #include "prelude.hpp"
 #include "language.hpp"
 
-#include <cstdlib>
-#include <cstring>
+#include <iosfwd>
+#include <vector>
 
 
 namespace banjo
@@ -28,6 +28,9 @@ namespace detail
 // union containing the kinds of arguments that can be rendered into
 // strings.
 //
+// Strings are copied, so that a message can be kept after the call
+// that created it (e.g., when diagnostics are deferred).
+//
 // TODO: This facility should most definitely move into lingo.
 //
 // TODO: Build a visitor for this.
@@ -52,7 +55,7 @@ struct Message_arg
     
     Token       k;
     Term const* t;
-    char const* s;
+    String      s;
     long        z;
     double      f;
   } u;
@@ -65,7 +68,8 @@ struct Message_arg
 
   Message_arg(Token const& k) : k(token_arg) { u.k = k; }
   Message_arg(Term const& t) : k(term_arg) { u.t = &t; }
-  Message_arg(char const* s) : k(cstr_arg) { u.s = strdup(s); }
+  Message_arg(char const* s) : k(cstr_arg) { new (&u.s) String(s); }
+  Message_arg(String const& s) : k(cstr_arg) { new (&u.s) String(s); }
   Message_arg(int n) : k(int_arg) { u.z = n; }
   Message_arg(std::size_t n) : k(int_arg) { u.z = n; }
   Message_arg(Integer const& n) : k(int_arg) { u.z = n.gets(); }
@@ -77,7 +81,7 @@ struct Message_arg
 
   Token const& token() const { return u.k; }
   Term const& term() const   { return *u.t; }
-  char const* str() const    { return u.s; }
+  char const* str() const    { return u.s.c_str(); }
   long integer() const       { return u.z; }
   double real() const        { return u.f; }
 
@@ -98,7 +102,7 @@ Message_arg::partial_copy(Rep const& r)
       u.t = r.t; 
       break;
     case cstr_arg:
-      u.s = strdup(r.s);
+      new (&u.s) String(r.s);
       break;
     case int_arg:
       u.z = r.z;
@@ -110,7 +114,7 @@ Message_arg::partial_copy(Rep const& r)
 
 
 // This is the same as partial copy, except for the handling of the
-// string representation.
+// token and string representations.
 inline void
 Message_arg::partial_move(Rep&& r)
 {
@@ -122,8 +126,7 @@ Message_arg::partial_move(Rep&& r)
       u.t = r.t; 
       break;
     case cstr_arg:
-      u.s = r.s;
-      r.s = nullptr;
+      new (&u.s) String(std::move(r.s));
       break;
     case int_arg:
       u.z = r.z;
@@ -142,7 +145,7 @@ Message_arg::partial_destroy(Rep& r)
       u.k.~Token();
       break;
     case cstr_arg:
-      free(const_cast<char*>(u.s));
+      u.s.~String();
       break;
     default:
       // All others are trivially destructible.
@@ -222,7 +225,8 @@ record_args(Arg_vec& vec, T const& t, Args const&... args)
 
 
 // A message contains the structure of a string that will be rendered into
-// a diagnostic.
+// a diagnostic. The format string is not copied; it is always a string
+// literal.
 //
 // TODO: Add methods to make this more consumable by users.
 //
@@ -265,10 +269,10 @@ struct Message
   void add_note(Message const& m) { notes_.push_back(m); }
   void add_note(Message&& m) { notes_.push_back(std::move(m)); }
 
-  Location loc_;   // The location of the error.
-  String   fmt_;   // The format string
-  Arg_list args_;  // The argument list
-  Msg_list notes_; // Additional information for the message
+  Location    loc_;   // The location of the error.
+  char const* fmt_;   // The format string
+  Arg_list    args_;  // The argument list
+  Msg_list    notes_; // Additional information for the message
 };
 
 
@@ -285,6 +289,54 @@ void dump(Message const&);
 void dump(std::ostream&, Message const&);
 
 
+// -------------------------------------------------------------------------- //
+// Diagnostics
+
+// The severity of a diagnostic.
+enum Diagnostic_level
+{
+  error_level,
+  warning_level,
+  note_level
+};
+
+
+// The format in which diagnostics are rendered.
+enum Diagnostic_format
+{
+  text_format,
+  json_format
+};
+
+
+// A diagnostic and the input location at which it was issued. The
+// message keeps its arguments as tokens, terms, and numbers; it is
+// rendered only when the diagnostic is printed.
+struct Diagnostic_record
+{
+  Diagnostic_level level;
+  Location         loc;
+  Message          msg;
+};
+
+
+// Collects and renders diagnostics. By default, diagnostics are printed
+// to stderr as they are issued. Deferred diagnostics are kept until they
+// are flushed, or until the collection is destroyed.
+struct Diagnostics
+{
+  ~Diagnostics();
+
+  void emit(Diagnostic_level, Location, Message const&);
+  void flush(std::ostream&);
+  void render(std::ostream&, Diagnostic_record const&);
+
+  Diagnostic_format              format   = text_format;
+  bool                           deferred = false;
+  std::vector<Diagnostic_record> records;
+};
+
+
 // -------------------------------------------------------------------------- //
 // Exceptions
 
@@ -410,6 +462,13 @@ struct Evaluation_error : Translation_error
 };
 
 
+// Represents an error reading an imported translation unit.
+struct Import_error : Translation_error
+{
+  using Translation_error::Translation_error;
+};
+
+
 // Represents an error caused by exceeding an implementation limit.
 struct Limitation_error : Translation_error
 {
@@ -24,8 +24,10 @@ Evaluator::alias(Decl const& d)
 
 
 // Load the value of an object corresponding to the given declaration.
-// This produces a value associated with the name.
-Value
+// This returns a view of the value associated with the name. Note that
+// copying the view is cheap, even for aggregates, since their elements
+// are shared until modified.
+Value const&
 Evaluator::load(Decl const& d)
 {
   return stack.lookup(&d)->second;
@@ -57,6 +59,27 @@ Evaluator::store(Decl const& d, Value const& v)
 }
 
 
+// Take an evaluation step. Diagnose an error if this exceeds the
+// limits on the number of steps or on the depth of nested steps.
+//
+// FIXME: What is the location of this error?
+void
+Evaluator::step()
+{
+  Evaluation_limits const& lim = cxt.evaluation_limits();
+  ++steps;
+  if (lim.steps && steps > lim.steps) {
+    error(cxt, "constant evaluation exceeded the limit of {} steps", lim.steps);
+    throw Evaluation_error();
+  }
+  if (lim.depth && depth >= lim.depth) {
+    error(cxt, "constant evaluation exceeded the nesting limit of {}", lim.depth);
+    throw Evaluation_error();
+  }
+  ++depth;
+}
+
+
 // -------------------------------------------------------------------------- //
 // Evaluation of expressions
 
@@ -96,7 +119,12 @@ Evaluator::evaluate(Expr const& e)
     Value operator()(Le_expr const& e)      { return self.le(e); }
     Value operator()(Ge_expr const& e)      { return self.ge(e); }
     Value operator()(Cmp_expr const& e)     { return self.cmp(e); }
+
+    Value operator()(Qualification_conv const& e) { return self.to_qualified(e); }
+    Value operator()(Boolean_conv const& e)       { return self.to_bool(e); }
+    Value operator()(Integer_conv const& e)       { return self.to_integer(e); }
   };
+  Enter_step s(*this);
   return apply(e, fn{*this});
 }
 
@@ -108,12 +136,12 @@ Evaluator::boolean(Boolean_expr const& e)
 }
 
 
+// The literal is converted to the precision of its type. This is
+// inline unless the literal requires more than 64 bits.
 Value
 Evaluator::integer(Integer_expr const& e)
 {
-  // FIXME: Eh? Is this right? Does it matter? It wouldn't if the
-  // value contained an actual integer.
-  return Integer_value(e.value().getu());
+  return make_integer(get_integer_spec(e.type()), e.value().impl());
 }
 
 
@@ -146,7 +174,8 @@ Evaluator::call(Call_expr const& e)
   Value v = evaluate(e.function());
   Function_decl const& f = cast<Function_decl>(*v.get_reference());
 
-  // There should probably be a body for the function.
+  // There should probably be a body for the function. Imported
+  // functions have none, so they cannot be evaluated.
   //
   // FIXME: What if the function is = default. How do we determine
   // what that behavior should be? Synthesize a new kind of definition
@@ -155,8 +184,11 @@ Evaluator::call(Call_expr const& e)
   // TODO: It would be more elegant to simply dispatch on the
   // definition rather than filter it here.
   Function_def const* def = as<Function_def>(&f.definition());
-  if (!def)
-    lingo_unreachable();
+  if (!def) {
+    error(cxt, "cannot evaluate '{}' without its definition", f.name());
+    throw Evaluation_error();
+  }
+  Profile_scope prof(*this, &f);
 
   // Each parameter is declared as a local variable within the
   // function.
@@ -221,18 +253,47 @@ Evaluator::logical_not(Not_expr const& e)
 // -------------------------------------------------------------------------- //
 // Evaluation of arithmetic expressions
 //
+// Arithmetic is computed in the precision and signedness of the
+// expression's type. Signed overflow and division by zero are not
+// constant expressions.
+//
 // TODO: This implementation assumes that all arithmetic operands have 
 // integer values. However, we'll need to dispatch based on the type.
+
+
+// Returns the integer specification for values of type t. Types other
+// than integer types (e.g., bool) are evaluated as 64-bit integers.
+Integer_spec
+get_integer_spec(Type const& t)
+{
+  if (Integer_type const* i = as<Integer_type>(&t))
+    return {i->precision(), i->is_signed()};
+  return {64, true};
+}
+
+
+// Returns the result of an arithmetic operation, or diagnoses an
+// error if the operation overflowed or divided by zero.
 //
-// TODO: Check for various forms of undefined behavior and throw an
-// appropriate exception.
+// FIXME: What is the location of this error?
+static Value
+check_arithmetic(Context& cxt, Value&& v)
+{
+  if (v.is_error()) {
+    error(cxt, "integer overflow or division by zero in constant expression");
+    throw Evaluation_error();
+  }
+  return std::move(v);
+}
+
 
 Value
 Evaluator::add(Add_expr const& e)
 {
   Value v1 = evaluate(e.left());
   Value v2 = evaluate(e.right());
-  return v1.get_integer() + v2.get_integer();
+  Value v = integer_add(get_integer_spec(e.type()), v1, v2);
+  return check_arithmetic(cxt, std::move(v));
 }
 
 
@@ -241,7 +302,8 @@ Evaluator::sub(Sub_expr const& e)
 {
   Value v1 = evaluate(e.left());
   Value v2 = evaluate(e.right());
-  return v1.get_integer() - v2.get_integer();
+  Value v = integer_sub(get_integer_spec(e.type()), v1, v2);
+  return check_arithmetic(cxt, std::move(v));
 }
 
 
@@ -250,7 +312,8 @@ Evaluator::mul(Mul_expr const& e)
 {
   Value v1 = evaluate(e.left());
   Value v2 = evaluate(e.right());
-  return v1.get_integer() * v2.get_integer();
+  Value v = integer_mul(get_integer_spec(e.type()), v1, v2);
+  return check_arithmetic(cxt, std::move(v));
 }
 
 
@@ -259,7 +322,8 @@ Evaluator::div(Div_expr const& e)
 {
   Value v1 = evaluate(e.left());
   Value v2 = evaluate(e.right());
-  return v1.get_integer() / v2.get_integer();
+  Value v = integer_div(get_integer_spec(e.type()), v1, v2);
+  return check_arithmetic(cxt, std::move(v));
 }
 
 
@@ -268,7 +332,8 @@ Evaluator::rem(Rem_expr const& e)
 {
   Value v1 = evaluate(e.left());
   Value v2 = evaluate(e.right());
-  return v1.get_integer() % v2.get_integer();
+  Value v = integer_rem(get_integer_spec(e.type()), v1, v2);
+  return check_arithmetic(cxt, std::move(v));
 }
 
 
@@ -283,13 +348,17 @@ Value
 Evaluator::neg(Neg_expr const& e)
 {
   Value v = evaluate(e.operand());
-  return -v.get_integer();
+  Value r = integer_neg(get_integer_spec(e.type()), v);
+  return check_arithmetic(cxt, std::move(r));
 }
 
 
 // -------------------------------------------------------------------------- //
 // Evaluation of relational expressions
 //
+// Operands are compared in the precision and signedness of the left
+// operand's type.
+//
 // TODO: This implementation assumes that all relational operands have 
 // integer values. However, we'll need to dispatch based on the type.
 
@@ -298,7 +367,7 @@ Evaluator::eq(Eq_expr const& e)
 {
   Value v1 = evaluate(e.left());
   Value v2 = evaluate(e.right());
-  return v1.get_integer() == v2.get_integer();
+  return integer_compare(get_integer_spec(e.left().type()), v1, v2) == 0;
 }
 
 
@@ -307,7 +376,7 @@ Evaluator::ne(Ne_expr const& e)
 {
   Value v1 = evaluate(e.left());
   Value v2 = evaluate(e.right());
-  return v1.get_integer() != v2.get_integer();
+  return integer_compare(get_integer_spec(e.left().type()), v1, v2) != 0;
 }
 
 
@@ -316,7 +385,7 @@ Evaluator::lt(Lt_expr const& e)
 {
   Value v1 = evaluate(e.left());
   Value v2 = evaluate(e.right());
-  return v1.get_integer() < v2.get_integer();
+  return integer_compare(get_integer_spec(e.left().type()), v1, v2) < 0;
 }
 
 
@@ -325,7 +394,7 @@ Evaluator::gt(Gt_expr const& e)
 {
   Value v1 = evaluate(e.left());
   Value v2 = evaluate(e.right());
-  return v1.get_integer() > v2.get_integer();
+  return integer_compare(get_integer_spec(e.left().type()), v1, v2) > 0;
 }
 
 
@@ -334,7 +403,7 @@ Evaluator::le(Le_expr const& e)
 {
   Value v1 = evaluate(e.left());
   Value v2 = evaluate(e.right());
-  return v1.get_integer() <= v2.get_integer();
+  return integer_compare(get_integer_spec(e.left().type()), v1, v2) <= 0;
 }
 
 
@@ -343,7 +412,7 @@ Evaluator::ge(Ge_expr const& e)
 {
   Value v1 = evaluate(e.left());
   Value v2 = evaluate(e.right());
-  return v1.get_integer() >= v2.get_integer();
+  return integer_compare(get_integer_spec(e.left().type()), v1, v2) >= 0;
 }
 
 
@@ -352,9 +421,10 @@ Evaluator::cmp(Cmp_expr const& e)
 {
   Value v1 = evaluate(e.left());
   Value v2 = evaluate(e.right());
-  if (v1.get_integer() < v2.get_integer())
+  int n = integer_compare(get_integer_spec(e.left().type()), v1, v2);
+  if (n < 0)
     return -1;
-  if (v1.get_integer() > v2.get_integer())
+  if (n > 0)
     return 1;
   return 0;
 }
@@ -375,6 +445,34 @@ Evaluator::to_value(Value_conv const& e)
 }
 
 
+// A qualification adjustment does not change the value.
+Value
+Evaluator::to_qualified(Qualification_conv const& e)
+{
+  return evaluate(e.source());
+}
+
+
+// The result is true when the source value is non-zero. Note that the
+// source is an integer; other sources are not constant expressions.
+Value
+Evaluator::to_bool(Boolean_conv const& e)
+{
+  Value v = evaluate(e.source());
+  return integer_compare(get_integer_spec(e.source().type()), v, Value(0)) != 0;
+}
+
+
+// Convert the integer to the precision of the destination type.
+Value
+Evaluator::to_integer(Integer_conv const& e)
+{
+  Value v = evaluate(e.source());
+  llvm::APSInt n = get_wide_integer(get_integer_spec(e.source().type()), v);
+  return make_integer(get_integer_spec(e.type()), n);
+}
+
+
 // -------------------------------------------------------------------------- //
 // Evaluation of statements
 
@@ -396,6 +494,7 @@ Evaluator::evaluate(Stmt const& s, Value& r)
     Control operator()(Expression_stmt const& s)  { return self.evaluate_expression(s, r); }
     Control operator()(Return_stmt const& s)      { return self.evaluate_return(s, r); }
   };
+  Enter_step st(*this);
   return apply(s, fn{*this, r});
 }
 
@@ -522,7 +621,82 @@ Evaluator::initialize(Value& obj, Aggregate_init const& init)
     agg[i] = Value{};
     initialize(agg[i], inits[i]);
   }
-  obj = agg;
+  obj = std::move(agg);
+}
+
+
+// -------------------------------------------------------------------------- //
+// Constant expressions
+
+// Returns true if every expression in the list is constant.
+static bool
+is_constant_list(Expr_list const& es)
+{
+  for (Expr const& e : es)
+    if (!is_constant_expression(e))
+      return false;
+  return true;
+}
+
+
+// Returns true if e is a constant expression. That is, e can be computed
+// by the evaluator without reference to objects or functions. Standard
+// conversions of constant expressions are constant, except for the
+// conversion of an object to its value, and conversions involving
+// floating point values, which are not evaluated. Note that
+// evaluating a constant expression may still fail (e.g., by overflow).
+// Constant initializers are computed by Evaluator::initialize rather
+// than Evaluator::evaluate.
+//
+// TODO: Allow references to meta variables and calls to meta functions.
+bool
+is_constant_expression(Expr const& e)
+{
+  struct fn
+  {
+    bool operator()(Expr const& e)           { return false; }
+    bool operator()(Boolean_expr const& e)   { return true; }
+    bool operator()(Integer_expr const& e)   { return true; }
+    bool operator()(Tuple_expr const& e)     { return is_constant_list(e.elements()); }
+    bool operator()(And_expr const& e)       { return binary(e); }
+    bool operator()(Or_expr const& e)        { return binary(e); }
+    bool operator()(Not_expr const& e)       { return unary(e); }
+
+    bool operator()(Add_expr const& e)       { return binary(e); }
+    bool operator()(Sub_expr const& e)       { return binary(e); }
+    bool operator()(Mul_expr const& e)       { return binary(e); }
+    bool operator()(Div_expr const& e)       { return binary(e); }
+    bool operator()(Rem_expr const& e)       { return binary(e); }
+    bool operator()(Pos_expr const& e)       { return unary(e); }
+    bool operator()(Neg_expr const& e)       { return unary(e); }
+
+    bool operator()(Eq_expr const& e)        { return binary(e); }
+    bool operator()(Ne_expr const& e)        { return binary(e); }
+    bool operator()(Lt_expr const& e)        { return binary(e); }
+    bool operator()(Gt_expr const& e)        { return binary(e); }
+    bool operator()(Le_expr const& e)        { return binary(e); }
+    bool operator()(Ge_expr const& e)        { return binary(e); }
+    bool operator()(Cmp_expr const& e)       { return binary(e); }
+
+    bool operator()(Standard_conv const& e)  { return is_constant_expression(e.source()); }
+    bool operator()(Value_conv const& e)     { return false; }
+    bool operator()(Float_conv const& e)     { return false; }
+    bool operator()(Numeric_conv const& e)   { return false; }
+
+    bool operator()(Copy_init const& e)      { return is_constant_expression(e.expression()); }
+    bool operator()(Aggregate_init const& e) { return is_constant_list(e.initializers()); }
+
+    bool unary(Unary_expr const& e)
+    {
+      return is_constant_expression(e.operand());
+    }
+
+    bool binary(Binary_expr const& e)
+    {
+      return is_constant_expression(e.left()) && is_constant_expression(e.right());
+    }
+  };
+  return apply(e, fn{});
 }
 
 
@@ -541,13 +715,16 @@ lift_error(Context& cxt, Type&, Error_value const& v)
 };
 
 
+// Construct an integer literal from the value. Note that the literal
+// is computed in the precision of the type so that unsigned 64-bit
+// values are not interpreted as negative numbers.
 static Expr&
-lift_integer(Context& cxt, Type& t, Integer_value const& v)
+lift_integer(Context& cxt, Type& t, Value const& v)
 {
   if (is_integer_type(t))
-    return cxt.get_integer(t, v); 
+    return cxt.get_integer(t, Integer(get_wide_integer(get_integer_spec(t), v)));
   if (is_boolean_type(t))
-    return cxt.get_boolean(t, v);
+    return cxt.get_boolean(t, v.get_integer());
 
   // TODO: What other kinds of integer representation do we have?
   lingo_unreachable();
@@ -581,21 +758,23 @@ lift_value(Context& cxt, Type& t, Value const& v)
 {
   struct fn
   {
-    fn(Context& c, Type& t)
-      : cxt(c), type(t)
+    fn(Context& c, Type& t, Value const& v)
+      : cxt(c), type(t), val(v)
     { }
 
-    Context& cxt;
-    Type&    type;
+    Context&     cxt;
+    Type&        type;
+    Value const& val;
 
     Expr& operator()(Error_value const& v)     { return lift_error(cxt, type, v); }
     Expr& operator()(Void_value const& v)      { lingo_unreachable(); }
-    Expr& operator()(Integer_value const& v)   { return lift_integer(cxt, type, v); }
+    Expr& operator()(Integer_value const& v)   { return lift_integer(cxt, type, val); }
+    Expr& operator()(Wide_value const& v)      { return lift_integer(cxt, type, val); }
     Expr& operator()(Float_value const& v)     { lingo_unreachable(); }
     Expr& operator()(Reference_value const& v) { lingo_unreachable(); }
     Expr& operator()(Aggregate_value const& v) { return lift_aggregate(cxt, type, v); }
   };
-  return apply(v, fn{cxt, t});
+  return apply(v, fn{cxt, t, v});
 }
 
 
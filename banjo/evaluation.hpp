@@ -11,6 +11,8 @@
 
 #include <lingo/environment.hpp>
 
+#include <chrono>
+
 
 namespace banjo
 {
@@ -38,6 +40,10 @@ enum Control
 // The evaluator is responsible for the interpretation  of a program as a 
 // value.
 //
+// Each expression and statement evaluated is a step. Evaluation fails
+// with a diagnostic when the number of steps or their nesting depth
+// exceeds the limits configured in the context.
+//
 // FIXME: 
 struct Evaluator
 {
@@ -75,7 +81,9 @@ struct Evaluator
   Value cmp(Cmp_expr const&);
 
   Value to_value(Value_conv const&);
+  Value to_qualified(Qualification_conv const&);
   Value to_bool(Boolean_conv const&);
+  Value to_integer(Integer_conv const&);
 
   Control evaluate(Stmt const&, Value&);
   Control evaluate_block(Compound_stmt const&, Value&);
@@ -92,15 +100,22 @@ struct Evaluator
   void initialize(Value&, Aggregate_init const&);
 
   // Load/store functions
-  Value& alloc(Decl const&);
-  Value  alias(Decl const&);
-  Value  load(Decl const&);
-  Value& store(Decl const&, Value const&);
+  Value&       alloc(Decl const&);
+  Value        alias(Decl const&);
+  Value const& load(Decl const&);
+  Value&       store(Decl const&, Value const&);
+
+  // Instrumentation
+  void step();
 
   struct Enter_frame;
+  struct Enter_step;
+  struct Profile_scope;
 
-  Context&   cxt;
-  Call_stack stack;
+  Context&    cxt;
+  Call_stack  stack;
+  std::size_t steps; // Number of steps taken
+  std::size_t depth; // Current nesting of steps
 };
 
 
@@ -109,7 +124,7 @@ struct Evaluator
 // constants.
 inline
 Evaluator::Evaluator(Context& c)
-  : cxt(c)
+  : cxt(c), steps(0), depth(0)
 {
   stack.push(&c.constants());
 }
@@ -144,6 +159,76 @@ struct Evaluator::Enter_frame
 };
 
 
+// A helper class that counts an evaluation step for the lifetime of
+// this object. Note that Evaluator::step() throws if a limit is
+// exceeded, in which case the depth is not incremented.
+struct Evaluator::Enter_step
+{
+  Enter_step(Evaluator& e)
+    : eval(e)
+  {
+    eval.step();
+  }
+
+  ~Enter_step()
+  {
+    --eval.depth;
+  }
+
+  Evaluator& eval;
+};
+
+
+// A helper class that attributes the steps and wall time of an
+// evaluation to a declaration. If no declaration is given, the 
+// evaluation is attributed to the current declaration context.
+// Nothing is recorded unless profiling is enabled.
+//
+// Note that calls are not evaluated (see Evaluator::call), so the
+// profile is per declaration, not per function called.
+struct Evaluator::Profile_scope
+{
+  using Clock = std::chrono::steady_clock;
+
+  Profile_scope(Evaluator&);
+  Profile_scope(Evaluator&, Decl const*);
+  ~Profile_scope();
+
+  Evaluator&        eval;
+  Decl const*       decl;
+  std::size_t       first; // Steps taken on entry
+  Clock::time_point start; // Time of entry
+};
+
+
+inline
+Evaluator::Profile_scope::Profile_scope(Evaluator& e)
+  : Profile_scope(e, e.cxt.cxt.empty() ? nullptr : &e.cxt.current_context())
+{ }
+
+
+inline
+Evaluator::Profile_scope::Profile_scope(Evaluator& e, Decl const* d)
+  : eval(e), decl(d), first(e.steps)
+{
+  if (eval.cxt.profile_evaluation())
+    start = Clock::now();
+}
+
+
+inline
+Evaluator::Profile_scope::~Profile_scope()
+{
+  if (!eval.cxt.profile_evaluation())
+    return;
+  std::chrono::duration<double> t = Clock::now() - start;
+  Evaluation_record& r = eval.cxt.evaluation_profile()[decl];
+  ++r.calls;
+  r.steps += eval.steps - first;
+  r.time += t.count();
+}
+
+
 // -------------------------------------------------------------------------- //
 // Expression evaluation
 
@@ -152,6 +237,7 @@ inline Value
 evaluate(Context& cxt, Expr const& e)
 {
   Evaluator eval(cxt);
+  Evaluator::Profile_scope prof(eval);
   return eval(e);
 }
 
@@ -162,10 +248,15 @@ inline void
 evaluate(Context& cxt, Decl const& d)
 {
   Evaluator eval(cxt);
+  Evaluator::Profile_scope prof(eval, &d);
   eval(d);
 }
 
 
+Integer_spec get_integer_spec(Type const&);
+bool         is_constant_expression(Expr const&);
+
+
 Expr const& reduce(Context&, Expr const&);
 Expr&       reduce(Context&, Expr&);
 
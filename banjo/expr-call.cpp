@@ -76,19 +76,16 @@ initialize_parameters(Context& cxt, Decl_list& parms, Expr_list& args)
 Function_candidate
 make_function_candidate(Context& cxt, Function_decl& f, Expr_list& args)
 {
+  cxt.record_failure(nullptr);
   try {
-    std::cout << "-------\n";
-    debug(f);
     Decl_list& parms = f.parameters();
     Expr_list conv = initialize_parameters(cxt, parms, args);
-    std::cout << "^^^^^^^\n";
     return {f, conv, true};
   } 
   catch (Compiler_error& err) {
-    // TOOD: We might want to copy the error into the candidate
-    // so we can re-throw it later. For now, just do this.
-    std::cout << "^^^^^^^\n";
-    return {f, args, false};
+    // Diagnostics are suppressed, so the only record of the error is
+    // its reason.
+    return {f, args, false, cxt.last_failure()};
   }
 }
 
@@ -39,13 +39,14 @@ make_error_ref(Context& cxt, Decl& d)
 
 // Returns a reference to the declared variable. In the general, the
 // type will be a reference to the declared variable. However, if the
-// declaration has meta-type, the result is an object.
+// declaration has meta-type, the result is an object. The type is
+// queried so that the enclosing query depends on it.
 //
 // TODO: Handle meta variables.
 static Expr&
 make_variable_ref(Context& cxt, Variable_decl& d)
 {
-  Type& t = cxt.get_reference_type(d.type());
+  Type& t = cxt.get_reference_type(type_of(cxt, d));
   return cxt.make_reference(t, d);
 }
 
@@ -55,7 +56,7 @@ make_variable_ref(Context& cxt, Variable_decl& d)
 static Expr&
 make_function_ref(Context& cxt, Function_decl& d)
 {
-  Type& t = cxt.get_reference_type(d.type());
+  Type& t = cxt.get_reference_type(type_of(cxt, d));
   return cxt.make_reference(t, d);
 }
 
@@ -0,0 +1,177 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#include "folding.hpp"
+#include "context.hpp"
+#include "evaluation.hpp"
+
+
+namespace banjo
+{
+
+// Returns true if e is a literal value. A tuple is a literal when all
+// of its elements are literals.
+bool
+is_literal(Expr const& e)
+{
+  if (is<Boolean_expr>(&e) || is<Integer_expr>(&e))
+    return true;
+  if (Tuple_expr const* t = as<Tuple_expr>(&e)) {
+    for (Expr const& e1 : t->elements())
+      if (!is_literal(e1))
+        return false;
+    return true;
+  }
+  return false;
+}
+
+
+// Reduce e to a literal, which has the location of e. If evaluation
+// fails (e.g., by overflow), e is returned unchanged, and a warning is
+// issued. The expression may still be computed at run time.
+static Expr&
+fold_reduce(Context& cxt, Expr& e)
+{
+  try {
+    Suppress_diagnostics diags(cxt);
+    Expr& r = reduce(cxt, e);
+    r.loc_ = e.loc_;
+    return r;
+  } catch (Evaluation_error&) {
+    warning(cxt, "constant expression '{}' cannot be folded", e);
+    return e;
+  }
+}
+
+
+static Expr&
+fold_tuple(Context& cxt, Tuple_expr& e)
+{
+  for (Expr*& e1 : e.elements().base())
+    e1 = &fold(cxt, *e1);
+  return e;
+}
+
+
+static Expr&
+fold_unary(Context& cxt, Unary_expr& e)
+{
+  e.op_ = &fold(cxt, e.operand());
+  if (is_literal(e.operand()))
+    return fold_reduce(cxt, e);
+  return e;
+}
+
+
+static Expr&
+fold_binary(Context& cxt, Binary_expr& e)
+{
+  e.left_ = &fold(cxt, e.left());
+  e.right_ = &fold(cxt, e.right());
+  if (is_literal(e.left()) && is_literal(e.right()))
+    return fold_reduce(cxt, e);
+  return e;
+}
+
+
+// Fold the operand of the conversion, but not the conversion itself.
+static Expr&
+fold_conversion(Context& cxt, Conv& e)
+{
+  e.expr = &fold(cxt, e.source());
+  return e;
+}
+
+
+static Expr&
+fold_copy_init(Context& cxt, Copy_init& e)
+{
+  e.expr = &fold(cxt, e.expression());
+  return e;
+}
+
+
+static Expr&
+fold_aggregate_init(Context& cxt, Aggregate_init& e)
+{
+  for (Expr*& e1 : e.initializers().base())
+    e1 = &fold(cxt, *e1);
+  return e;
+}
+
+
+// Returns the folded form of e. The operands of e are folded in place.
+//
+// TODO: Fold the arguments of calls. Fold calls to meta functions.
+Expr&
+fold(Context& cxt, Expr& e)
+{
+  struct fn
+  {
+    Context& cxt;
+    Expr& operator()(Expr& e)           { return e; }
+    Expr& operator()(Tuple_expr& e)     { return fold_tuple(cxt, e); }
+    Expr& operator()(Add_expr& e)       { return fold_binary(cxt, e); }
+    Expr& operator()(Sub_expr& e)       { return fold_binary(cxt, e); }
+    Expr& operator()(Mul_expr& e)       { return fold_binary(cxt, e); }
+    Expr& operator()(Div_expr& e)       { return fold_binary(cxt, e); }
+    Expr& operator()(Rem_expr& e)       { return fold_binary(cxt, e); }
+    Expr& operator()(Neg_expr& e)       { return fold_unary(cxt, e); }
+    Expr& operator()(Pos_expr& e)       { return fold_unary(cxt, e); }
+    Expr& operator()(Eq_expr& e)        { return fold_binary(cxt, e); }
+    Expr& operator()(Ne_expr& e)        { return fold_binary(cxt, e); }
+    Expr& operator()(Lt_expr& e)        { return fold_binary(cxt, e); }
+    Expr& operator()(Gt_expr& e)        { return fold_binary(cxt, e); }
+    Expr& operator()(Le_expr& e)        { return fold_binary(cxt, e); }
+    Expr& operator()(Ge_expr& e)        { return fold_binary(cxt, e); }
+    Expr& operator()(Cmp_expr& e)       { return fold_binary(cxt, e); }
+    Expr& operator()(And_expr& e)       { return fold_binary(cxt, e); }
+    Expr& operator()(Or_expr& e)        { return fold_binary(cxt, e); }
+    Expr& operator()(Not_expr& e)       { return fold_unary(cxt, e); }
+    Expr& operator()(Conv& e)           { return fold_conversion(cxt, e); }
+    Expr& operator()(Copy_init& e)      { return fold_copy_init(cxt, e); }
+    Expr& operator()(Aggregate_init& e) { return fold_aggregate_init(cxt, e); }
+  };
+  return apply(e, fn{cxt});
+}
+
+
+// Fold the extents of array types within t. Note that the extent
+// is replaced in place.
+void
+fold(Context& cxt, Type& t)
+{
+  struct fn
+  {
+    Context& cxt;
+    void operator()(Type& t) { }
+    
+    void operator()(Array_type& t)
+    {
+      fold(cxt, t.element_type());
+      t.expr_ = &fold(cxt, t.extent());
+    }
+
+    void operator()(Tuple_type& t)
+    {
+      for (Type& t1 : t.element_types())
+        fold(cxt, t1);
+    }
+
+    void operator()(Function_type& t)
+    {
+      for (Type& t1 : t.parameter_types())
+        fold(cxt, t1);
+      fold(cxt, t.return_type());
+    }
+
+    void operator()(Pointer_type& t)
+    {
+      fold(cxt, t.type());
+    }
+  };
+  apply(t, fn{cxt});
+}
+
+
+} // namespace banjo
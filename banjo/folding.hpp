@@ -0,0 +1,31 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#ifndef BANJO_FOLDING_HPP
+#define BANJO_FOLDING_HPP
+
+// This module defines constant folding. Folding replaces constant
+// subexpressions of a term with the literals that they compute. Only
+// subexpressions whose operands are literals, and which the evaluator
+// can compute, are folded. Expressions whose evaluation fails (e.g., 
+// by overflow) are left unchanged, and a warning is issued.
+
+#include "ast.hpp"
+
+
+namespace banjo
+{
+
+struct Context;
+
+
+Expr& fold(Context&, Expr&);
+void  fold(Context&, Type&);
+
+bool is_literal(Expr const&);
+
+
+} // namespace banjo
+
+
+#endif
@@ -372,6 +372,7 @@ struct Basic_term_hash
 
 using Name_hash = Basic_term_hash<Name>;
 using Type_hash = Basic_term_hash<Type>;
+using Expr_hash = Basic_term_hash<Expr>;
 
 
 } // namespace banjo
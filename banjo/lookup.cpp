@@ -38,6 +38,12 @@ unqualified_lookup(Context& cxt, Name const& name)
     p = p->enclosing_scope();
   }
 
+  // A name not declared in the program may be declared by an imported
+  // translation unit.
+  Decl_list ds = cxt.lookup_imports(name);
+  if (!ds.empty())
+    return ds;
+
   error(cxt, "no matching declaration for '{}'", name);
   throw Lookup_error("no matching declaration");
 }
@@ -65,18 +65,22 @@ struct Resolution
 // In overload resolution, this represents a candidate for the function
 // call. That is, it is a potential resolution. This type extends the
 // resolution with bookkeeping information used to support resolution.
-//
-// TODO: Store information about non-viable function candidates.
+// A non-viable candidate records the reason it was rejected.
 struct Function_candidate : Resolution
 {
-  Function_candidate(Function_decl& f, Expr_list const& a, bool v)
-    : Resolution(f, a), viable_(v)
+  Function_candidate(Function_decl& f, Expr_list const& a, bool v, char const* r = nullptr)
+    : Resolution(f, a), viable_(v), reason_(r)
   { }
 
   // Converts to true iff the candidate is viable.
   explicit operator bool() const { return viable_; }
 
-  bool viable_;
+  // Returns the reason the candidate is not viable, if known. This
+  // is the unformatted text of the diagnostic.
+  char const* reason() const { return reason_; }
+
+  bool        viable_;
+  char const* reason_;
 };
 
 
@@ -0,0 +1,148 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#include "query.hpp"
+#include "ast.hpp"
+#include "context.hpp"
+
+#include <algorithm>
+
+
+namespace banjo
+{
+
+// Returns the definition of the declaration.
+static Def&
+get_definition(Decl& d)
+{
+  struct fn
+  {
+    Def& operator()(Decl& d)          { lingo_unhandled(d); }
+    Def& operator()(Variable_decl& d) { return d.initializer(); }
+    Def& operator()(Function_decl& d) { return d.definition(); }
+    Def& operator()(Class_decl& d)    { return d.definition(); }
+    Def& operator()(Concept_decl& d)  { return d.definition(); }
+  };
+  return apply(d, fn{});
+}
+
+
+// The default providers read the properties of elaborated terms.
+Query_engine::Query_engine(Context& c)
+  : cxt(c)
+{
+  providers[type_query] = [](Term& t) -> Query_result {
+    return {&cast<Typed_decl>(t).type()};
+  };
+  providers[body_query] = [](Term& t) -> Query_result {
+    return {&get_definition(cast<Decl>(t))};
+  };
+}
+
+
+// Replace the provider for the given kind of query. Previously
+// computed results are not affected.
+void
+Query_engine::provide(Query_kind k, Query_fn f)
+{
+  providers[k] = std::move(f);
+}
+
+
+// Returns the result of the query, computing it if needed. If another
+// query is being computed, that query is recorded as a user of this
+// one. It is an error for a query to depend on itself.
+Query_result const&
+Query_engine::get(Query_kind k, Term& t)
+{
+  Query q {k, &t};
+  auto iter = cache.find(q);
+  if (iter != cache.end() && !iter->second.done) {
+    error(cxt, "'{}' depends on itself", t);
+    throw Translation_error();
+  }
+
+  Entry& ent = cache[q];
+  if (!active.empty()) {
+    Query const& u = active.back();
+    if (std::find(ent.users.begin(), ent.users.end(), u) == ent.users.end())
+      ent.users.push_back(u);
+  }
+  if (ent.done) {
+    ++stats_.hits;
+    return ent.result;
+  }
+
+  if (!providers[k])
+    banjo_unimplemented("query provider");
+  ++stats_.misses;
+  active.push_back(q);
+  Query_result r;
+  try {
+    r = providers[k](t);
+  } catch (...) {
+    active.pop_back();
+    cache.erase(q);
+    throw;
+  }
+  active.pop_back();
+
+  // The entry may have been invalidated during computation.
+  Entry& e = cache[q];
+  e.result = r;
+  e.done = true;
+  return e.result;
+}
+
+
+// Discard the result of the query and of all queries that used it.
+void
+Query_engine::invalidate(Query const& q)
+{
+  auto iter = cache.find(q);
+  if (iter == cache.end() || !iter->second.done)
+    return;
+  std::vector<Query> users = std::move(iter->second.users);
+  cache.erase(iter);
+  ++stats_.invalidations;
+  for (Query const& u : users)
+    invalidate(u);
+}
+
+
+// Discard all results computed for the term.
+void
+Query_engine::invalidate(Term const& t)
+{
+  for (int k = 0; k < last_query; ++k)
+    invalidate(Query {Query_kind(k), &t});
+}
+
+
+// Discard all results.
+void
+Query_engine::clear()
+{
+  lingo_assert(active.empty());
+  cache.clear();
+}
+
+
+// -------------------------------------------------------------------------- //
+// Queries
+
+Type&
+type_of(Context& cxt, Decl& d)
+{
+  return cast<Type>(*cxt.queries().get(type_query, d).term);
+}
+
+
+Def&
+body_of(Context& cxt, Decl& d)
+{
+  return cast<Def>(*cxt.queries().get(body_query, d).term);
+}
+
+
+} // namespace banjo
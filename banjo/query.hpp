@@ -0,0 +1,142 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#ifndef BANJO_QUERY_HPP
+#define BANJO_QUERY_HPP
+
+// Semantic queries. A query computes a property of a term on demand,
+// e.g., the type of a declaration. Results are memoized, and the
+// queries made while computing a result are recorded as its
+// dependencies. Invalidating a term discards the results computed
+// for that term and, transitively, every result that depended on them.
+//
+// The computation of each kind of query is given by a provider. The
+// core library provides queries that simply read the properties of
+// elaborated terms; a frontend replaces those with providers that
+// elaborate the term as needed.
+
+#include "prelude.hpp"
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+
+namespace banjo
+{
+
+struct Context;
+struct Term;
+struct Type;
+struct Def;
+struct Decl;
+
+
+// The kinds of queries.
+enum Query_kind
+{
+  type_query, // The type of a declaration
+  body_query, // The definition of a declaration
+  last_query
+};
+
+
+// A query is a kind of question about a term.
+struct Query
+{
+  Query_kind  kind;
+  Term const* term;
+};
+
+
+inline bool
+operator==(Query const& a, Query const& b)
+{
+  return a.kind == b.kind && a.term == b.term;
+}
+
+
+struct Query_hash
+{
+  std::size_t operator()(Query const& q) const
+  {
+    return std::hash<Term const*>()(q.term) * (last_query + 1) + q.kind;
+  }
+};
+
+
+// The answer to a query.
+struct Query_result
+{
+  Term* term = nullptr;
+};
+
+
+// Computes the result of a query for a term.
+using Query_fn = std::function<Query_result(Term&)>;
+
+
+// Cumulative statistics for the query engine.
+struct Query_stats
+{
+  std::size_t hits          = 0; // Results found in the cache
+  std::size_t misses        = 0; // Results computed
+  std::size_t invalidations = 0; // Results discarded
+};
+
+
+// Memoizes the results of queries and tracks the dependencies between
+// them.
+struct Query_engine
+{
+  // A cached result, and the queries whose results were computed
+  // from it.
+  struct Entry
+  {
+    Query_result       result;
+    bool               done = false;
+    std::vector<Query> users;
+  };
+
+  using Cache = std::unordered_map<Query, Entry, Query_hash>;
+
+  Query_engine(Context&);
+
+  void provide(Query_kind, Query_fn);
+
+  Query_result const& get(Query_kind, Term&);
+  bool is_cached(Query_kind, Term const&) const;
+
+  void invalidate(Query const&);
+  void invalidate(Term const&);
+  void clear();
+
+  Query_stats const& stats() const { return stats_; }
+
+  Context&           cxt;
+  Query_fn           providers[last_query];
+  Cache              cache;
+  std::vector<Query> active; // Queries being computed
+  Query_stats        stats_;
+};
+
+
+// Returns true if the result of the query has been computed and not
+// invalidated.
+inline bool
+Query_engine::is_cached(Query_kind k, Term const& t) const
+{
+  auto iter = cache.find({k, &t});
+  return iter != cache.end() && iter->second.done;
+}
+
+
+// Queries
+Type& type_of(Context&, Decl&);
+Def&  body_of(Context&, Decl&);
+
+
+} // namespace banjo
+
+
+#endif
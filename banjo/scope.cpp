@@ -4,6 +4,7 @@
 #include "scope.hpp"
 #include "ast.hpp"
 
+#include <algorithm>
 #include <iostream>
 
 
@@ -18,6 +19,21 @@ Scope::bind(Decl& d)
 }
 
 
+// Remove the name binding for the declaration `d`, if any.
+void
+Scope::unbind(Decl& d)
+{
+  auto iter = names.find(&d.name());
+  if (iter == names.end())
+    return;
+  Overload_set& ovl = iter->second;
+  auto& ds = ovl.base();
+  ds.erase(std::remove(ds.begin(), ds.end(), &d), ds.end());
+  if (ovl.is_empty())
+    names.erase(iter);
+}
+
+
 // Streaming
 
 #if 0
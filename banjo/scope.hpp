@@ -59,6 +59,10 @@ struct Scope
   Binding& bind(Decl& d);
   Binding& bind(Name const&, Decl&);
 
+  // Remove the declaration from its overload set. The name is
+  // unbound when its overload set becomes empty.
+  void unbind(Decl& d);
+
   // Return the binding for the given symbol, or nullptr
   // if no such binding exists.
   Overload_set const* lookup(Name const& n) const;
@@ -0,0 +1,1133 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#include "serialization.hpp"
+#include "context.hpp"
+
+#include <lingo/error.hpp>
+
+#include <llvm/ADT/APSInt.h>
+
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace banjo
+{
+
+// The kinds of node records. The reader relies on the nodes of each
+// category being numbered together, in this order.
+enum Node_kind : std::uint32_t
+{
+  null_kind,
+#define define_node(Node) Node##_kind,
+#include "ast-name.def"
+#include "ast-type.def"
+#include "ast-expr.def"
+#include "ast-stmt.def"
+#include "ast-decl.def"
+#include "ast-def.def"
+#undef define_node
+  last_kind
+};
+
+
+using Record = Ast_writer::Record;
+using Cursor = Ast_reader::Cursor;
+
+
+// -------------------------------------------------------------------------- //
+// Writing
+
+static void
+write_name(Ast_writer& w, Record& r, Name const& n)
+{
+  struct fn
+  {
+    Ast_writer& w;
+    Record&     r;
+
+    void operator()(Name const& n) { lingo_unhandled(n); }
+
+    void operator()(Simple_id const& n)
+    {
+      r.push_back(Simple_id_kind);
+      r.push_back(w.string(n.symbol().spelling()));
+    }
+  };
+  apply(n, fn{w, r});
+}
+
+
+// The fields of a type are its kind, category, and qualifiers,
+// followed by the fields of the specific type.
+static void
+write_type(Ast_writer& w, Record& r, Type const& t)
+{
+  struct fn
+  {
+    Ast_writer& w;
+    Record&     r;
+
+    void head(Node_kind k, Type const& t)
+    {
+      r.push_back(k);
+      r.push_back(t.category());
+      r.push_back(t.qualifiers());
+    }
+
+    void operator()(Type const& t) { lingo_unhandled(t); }
+
+    void operator()(Void_type const& t)    { head(Void_type_kind, t); }
+    void operator()(Boolean_type const& t) { head(Boolean_type_kind, t); }
+    void operator()(Byte_type const& t)    { head(Byte_type_kind, t); }
+
+    void operator()(Integer_type const& t)
+    {
+      head(Integer_type_kind, t);
+      r.push_back(t.sign_);
+      r.push_back(t.prec_);
+    }
+
+    void operator()(Float_type const& t)
+    {
+      head(Float_type_kind, t);
+      r.push_back(t.prec_);
+    }
+
+    void operator()(Function_type const& t)
+    {
+      head(Function_type_kind, t);
+      w.list(r, t.parms_);
+      r.push_back(w.node(t.ret_));
+    }
+
+    void operator()(Array_type const& t)
+    {
+      head(Array_type_kind, t);
+      r.push_back(w.node(t.type_));
+      r.push_back(w.node(t.expr_));
+    }
+
+    void operator()(Tuple_type const& t)
+    {
+      head(Tuple_type_kind, t);
+      w.list(r, t.elems_);
+    }
+
+    void operator()(Pointer_type const& t)
+    {
+      head(Pointer_type_kind, t);
+      r.push_back(w.node(t.type_));
+    }
+
+    void operator()(Class_type const& t)
+    {
+      head(Class_type_kind, t);
+      r.push_back(w.node(t.decl_));
+    }
+  };
+  apply(t, fn{w, r});
+}
+
+
+// The fields of an expression are its kind and type, followed by the
+// fields of the specific expression. Integers are written in their full
+// width: the number of bits, the signedness, and then each 64-bit word
+// of the value as two words, low first.
+static void
+write_expr(Ast_writer& w, Record& r, Expr const& e)
+{
+  struct fn
+  {
+    Ast_writer& w;
+    Record&     r;
+
+    void head(Node_kind k, Expr const& e)
+    {
+      r.push_back(k);
+      r.push_back(w.node(e.type_));
+    }
+
+    void unary(Node_kind k, Unary_expr const& e)
+    {
+      head(k, e);
+      r.push_back(w.node(e.op_));
+      r.push_back(w.node(e.res_));
+    }
+
+    void binary(Node_kind k, Binary_expr const& e)
+    {
+      head(k, e);
+      r.push_back(w.node(e.left_));
+      r.push_back(w.node(e.right_));
+      r.push_back(w.node(e.res_));
+    }
+
+    void conversion(Node_kind k, Conv const& e)
+    {
+      head(k, e);
+      r.push_back(w.node(e.expr));
+    }
+
+    void operator()(Expr const& e) { lingo_unhandled(e); }
+
+    void operator()(Void_expr const& e) { head(Void_expr_kind, e); }
+
+    void operator()(Boolean_expr const& e)
+    {
+      head(Boolean_expr_kind, e);
+      r.push_back(e.value());
+    }
+
+    void operator()(Integer_expr const& e)
+    {
+      head(Integer_expr_kind, e);
+      llvm::APSInt const& n = e.value().impl();
+      r.push_back(n.getBitWidth());
+      r.push_back(n.isUnsigned());
+      for (unsigned i = 0; i < n.getNumWords(); ++i) {
+        std::uint64_t w = n.getRawData()[i];
+        r.push_back(w);
+        r.push_back(w >> 32);
+      }
+    }
+
+    void operator()(Tuple_expr const& e)
+    {
+      head(Tuple_expr_kind, e);
+      w.list(r, e.elems_);
+    }
+
+    void operator()(Decl_ref const& e)
+    {
+      head(Decl_ref_kind, e);
+      r.push_back(w.node(e.name_));
+      r.push_back(w.node(e.decl_));
+    }
+
+    void operator()(Add_expr const& e)     { binary(Add_expr_kind, e); }
+    void operator()(Sub_expr const& e)     { binary(Sub_expr_kind, e); }
+    void operator()(Mul_expr const& e)     { binary(Mul_expr_kind, e); }
+    void operator()(Div_expr const& e)     { binary(Div_expr_kind, e); }
+    void operator()(Rem_expr const& e)     { binary(Rem_expr_kind, e); }
+    void operator()(Neg_expr const& e)     { unary(Neg_expr_kind, e); }
+    void operator()(Pos_expr const& e)     { unary(Pos_expr_kind, e); }
+    void operator()(Bit_and_expr const& e) { binary(Bit_and_expr_kind, e); }
+    void operator()(Bit_or_expr const& e)  { binary(Bit_or_expr_kind, e); }
+    void operator()(Bit_xor_expr const& e) { binary(Bit_xor_expr_kind, e); }
+    void operator()(Bit_lsh_expr const& e) { binary(Bit_lsh_expr_kind, e); }
+    void operator()(Bit_rsh_expr const& e) { binary(Bit_rsh_expr_kind, e); }
+    void operator()(Bit_not_expr const& e) { unary(Bit_not_expr_kind, e); }
+    void operator()(Eq_expr const& e)      { binary(Eq_expr_kind, e); }
+    void operator()(Ne_expr const& e)      { binary(Ne_expr_kind, e); }
+    void operator()(Lt_expr const& e)      { binary(Lt_expr_kind, e); }
+    void operator()(Gt_expr const& e)      { binary(Gt_expr_kind, e); }
+    void operator()(Le_expr const& e)      { binary(Le_expr_kind, e); }
+    void operator()(Ge_expr const& e)      { binary(Ge_expr_kind, e); }
+    void operator()(Cmp_expr const& e)     { binary(Cmp_expr_kind, e); }
+    void operator()(And_expr const& e)     { binary(And_expr_kind, e); }
+    void operator()(Or_expr const& e)      { binary(Or_expr_kind, e); }
+    void operator()(Not_expr const& e)     { unary(Not_expr_kind, e); }
+    void operator()(Assign_expr const& e)  { binary(Assign_expr_kind, e); }
+
+    void operator()(Call_expr const& e)
+    {
+      head(Call_expr_kind, e);
+      r.push_back(w.node(e.fn));
+      w.list(r, e.args);
+      r.push_back(w.node(e.res_));
+    }
+
+    void operator()(Value_conv const& e)         { conversion(Value_conv_kind, e); }
+    void operator()(Qualification_conv const& e) { conversion(Qualification_conv_kind, e); }
+    void operator()(Boolean_conv const& e)       { conversion(Boolean_conv_kind, e); }
+    void operator()(Integer_conv const& e)       { conversion(Integer_conv_kind, e); }
+    void operator()(Float_conv const& e)         { conversion(Float_conv_kind, e); }
+    void operator()(Numeric_conv const& e)       { conversion(Numeric_conv_kind, e); }
+    void operator()(Dependent_conv const& e)     { conversion(Dependent_conv_kind, e); }
+    void operator()(Ellipsis_conv const& e)      { conversion(Ellipsis_conv_kind, e); }
+
+    void operator()(Trivial_init const& e) { head(Trivial_init_kind, e); }
+
+    void operator()(Copy_init const& e)
+    {
+      head(Copy_init_kind, e);
+      r.push_back(w.node(e.expr));
+    }
+
+    void operator()(Bind_init const& e)
+    {
+      head(Bind_init_kind, e);
+      r.push_back(w.node(e.expr));
+    }
+
+    void operator()(Direct_init const& e)
+    {
+      head(Direct_init_kind, e);
+      r.push_back(w.node(e.ctor));
+      w.list(r, e.args);
+    }
+
+    void operator()(Aggregate_init const& e)
+    {
+      head(Aggregate_init_kind, e);
+      w.list(r, e.inits);
+    }
+  };
+  apply(e, fn{w, r});
+}
+
+
+static void
+write_stmt(Ast_writer& w, Record& r, Stmt const& s)
+{
+  struct fn
+  {
+    Ast_writer& w;
+    Record&     r;
+
+    void operator()(Stmt const& s) { lingo_unhandled(s); }
+
+    void operator()(Empty_stmt const& s)    { r.push_back(Empty_stmt_kind); }
+    void operator()(Return_stmt const& s)   { r.push_back(Return_stmt_kind); }
+    void operator()(Yield_stmt const& s)    { r.push_back(Yield_stmt_kind); }
+    void operator()(Break_stmt const& s)    { r.push_back(Break_stmt_kind); }
+    void operator()(Continue_stmt const& s) { r.push_back(Continue_stmt_kind); }
+
+    void operator()(Compound_stmt const& s)
+    {
+      r.push_back(Compound_stmt_kind);
+      w.list(r, s.stmts_);
+    }
+
+    void operator()(Expression_stmt const& s)
+    {
+      r.push_back(Expression_stmt_kind);
+      r.push_back(w.node(s.expr_));
+    }
+
+    void operator()(Declaration_stmt const& s)
+    {
+      r.push_back(Declaration_stmt_kind);
+      r.push_back(w.node(s.decl_));
+    }
+
+    void operator()(Return_value_stmt const& s)
+    {
+      r.push_back(Return_value_stmt_kind);
+      r.push_back(w.node(s.expr_));
+    }
+
+    void operator()(Yield_value_stmt const& s)
+    {
+      r.push_back(Yield_value_stmt_kind);
+      r.push_back(w.node(s.expr_));
+    }
+
+    void operator()(If_then_stmt const& s)
+    {
+      r.push_back(If_then_stmt_kind);
+      r.push_back(w.node(s.cond_));
+      r.push_back(w.node(s.then_));
+    }
+
+    void operator()(If_else_stmt const& s)
+    {
+      r.push_back(If_else_stmt_kind);
+      r.push_back(w.node(s.cond_));
+      r.push_back(w.node(s.true_));
+      r.push_back(w.node(s.false_));
+    }
+
+    void operator()(While_stmt const& s)
+    {
+      r.push_back(While_stmt_kind);
+      r.push_back(w.node(s.cond_));
+      r.push_back(w.node(s.body_));
+      r.push_back(s.hints_.vectorize);
+      r.push_back(s.hints_.unroll);
+    }
+  };
+  apply(s, fn{w, r});
+}
+
+
+// The fields of a declaration are its kind, name, specifiers, and
+// context, followed by the fields of the specific declaration. The
+// translation unit only records its statements.
+static void
+write_decl(Ast_writer& w, Record& r, Decl const& d)
+{
+  struct fn
+  {
+    Ast_writer& w;
+    Record&     r;
+
+    void head(Node_kind k, Decl const& d)
+    {
+      r.push_back(k);
+      r.push_back(w.node(d.name_));
+      r.push_back(d.spec_);
+      r.push_back(w.node(d.cxt_));
+    }
+
+    void operator()(Decl const& d) { lingo_unhandled(d); }
+
+    void operator()(Translation_unit const& d)
+    {
+      r.push_back(Translation_unit_kind);
+      w.list(r, d.stmts_);
+    }
+
+    void operator()(Variable_decl const& d)
+    {
+      head(Variable_decl_kind, d);
+      r.push_back(w.node(d.type_));
+      r.push_back(w.node(d.def_));
+    }
+
+    void operator()(Function_decl const& d)
+    {
+      head(Function_decl_kind, d);
+      r.push_back(w.node(d.type_));
+      w.list(r, d.parms_);
+      r.push_back(w.node(d.def_));
+    }
+
+    void operator()(Class_decl const& d)
+    {
+      head(Class_decl_kind, d);
+      r.push_back(w.node(d.def_));
+    }
+
+    void operator()(Variable_parm const& d)
+    {
+      head(Variable_parm_kind, d);
+      r.push_back(w.node(d.type_));
+      r.push_back(w.node(d.def_));
+      r.push_back(d.ix_.depth());
+      r.push_back(d.ix_.offset());
+    }
+  };
+  apply(d, fn{w, r});
+}
+
+
+static void
+write_def(Ast_writer& w, Record& r, Def const& d)
+{
+  struct fn
+  {
+    Ast_writer& w;
+    Record&     r;
+
+    void operator()(Def const& d) { lingo_unhandled(d); }
+
+    void operator()(Empty_def const& d)     { r.push_back(Empty_def_kind); }
+    void operator()(Deleted_def const& d)   { r.push_back(Deleted_def_kind); }
+    void operator()(Defaulted_def const& d) { r.push_back(Defaulted_def_kind); }
+
+    void operator()(Expression_def const& d)
+    {
+      r.push_back(Expression_def_kind);
+      r.push_back(w.node(d.expr_));
+    }
+
+    void operator()(Function_def const& d)
+    {
+      r.push_back(Function_def_kind);
+      r.push_back(w.node(d.stmt_));
+    }
+
+    void operator()(Class_def const& d)
+    {
+      r.push_back(Class_def_kind);
+      w.list(r, d.stmts_);
+      w.list(r, d.bases_);
+      w.list(r, d.objs_);
+    }
+  };
+  apply(d, fn{w, r});
+}
+
+
+// Node 0 is reserved for null references.
+Ast_writer::Ast_writer()
+  : index(1, 0)
+{ }
+
+
+// Returns the id of the node, writing its record if needed. The id
+// is assigned before the fields are written, so that declarations can
+// refer to themselves. Records are appended after those of the nodes
+// they refer to.
+std::uint32_t
+Ast_writer::node(Term const& t)
+{
+  auto iter = ids.find(&t);
+  if (iter != ids.end())
+    return iter->second;
+  std::uint32_t n = index.size();
+  ids.emplace(&t, n);
+  index.push_back(0);
+
+  Record r;
+  if (Name const* x = as<Name>(&t))
+    write_name(*this, r, *x);
+  else if (Type const* x = as<Type>(&t))
+    write_type(*this, r, *x);
+  else if (Expr const* x = as<Expr>(&t))
+    write_expr(*this, r, *x);
+  else if (Stmt const* x = as<Stmt>(&t))
+    write_stmt(*this, r, *x);
+  else if (Decl const* x = as<Decl>(&t))
+    write_decl(*this, r, *x);
+  else if (Def const* x = as<Def>(&t))
+    write_def(*this, r, *x);
+  else
+    lingo_unhandled(t);
+
+  index[n] = data.size();
+  data.insert(data.end(), r.begin(), r.end());
+  return n;
+}
+
+
+std::uint32_t
+Ast_writer::node(Term const* t)
+{
+  return t ? node(*t) : 0;
+}
+
+
+// Returns the index of the string in the string table.
+std::uint32_t
+Ast_writer::string(String const& s)
+{
+  auto ins = strings.emplace(s, spellings.size());
+  if (ins.second)
+    spellings.push_back(s);
+  return ins.first->second;
+}
+
+
+// Write the translation unit to the file at the given path. Returns
+// false if the file could not be written.
+bool
+Ast_writer::operator()(Translation_unit const& tu, String const& path)
+{
+  std::uint32_t root = node(tu);
+
+  // Named declarations in the translation unit are exported.
+  Record exports;
+  for (Stmt const& s : tu.statements()) {
+    if (Declaration_stmt const* ds = as<Declaration_stmt>(&s)) {
+      Decl const& d = ds->declaration();
+      if (Simple_id const* id = as<Simple_id>(d.name_)) {
+        exports.push_back(string(id->symbol().spelling()));
+        exports.push_back(node(d));
+      }
+    }
+  }
+
+  // The string table is an array of offsets followed by the length
+  // and characters of each string, padded to a word.
+  Record strs(spellings.size());
+  for (std::size_t i = 0; i < spellings.size(); ++i) {
+    String const& s = spellings[i];
+    std::size_t n = strs.size();
+    strs[i] = sizeof(Ast_header) + 4 * n;
+    strs.resize(n + 1 + (s.size() + 3) / 4);
+    strs[n] = s.size();
+    std::memcpy(strs.data() + n + 1, s.data(), s.size());
+  }
+
+  Ast_header h;
+  h.magic = ast_magic;
+  h.version = ast_version;
+  h.strings = spellings.size();
+  h.string_offset = sizeof(Ast_header);
+  h.nodes = index.size();
+  h.node_offset = h.string_offset + 4 * strs.size();
+  h.index_offset = h.node_offset + 4 * data.size();
+  h.exports = exports.size() / 2;
+  h.export_offset = h.index_offset + 4 * index.size();
+  h.root = root;
+
+  std::ofstream os(path, std::ios::binary);
+  if (!os) {
+    lingo::error("cannot open '{}' for writing", path);
+    return false;
+  }
+  auto write = [&os](Record const& r) {
+    os.write((char const*)r.data(), 4 * r.size());
+  };
+  os.write((char const*)&h, sizeof(h));
+  write(strs);
+  write(data);
+  write(index);
+  write(exports);
+  return (bool)os;
+}
+
+
+// -------------------------------------------------------------------------- //
+// Reading
+
+static Name&
+read_name(Ast_reader& r, Node_kind k, Cursor& c)
+{
+  switch (k) {
+    case Simple_id_kind:
+      return r.cxt.get_id(r.symbol(c()));
+    default:
+      r.malformed();
+  }
+}
+
+
+static Type&
+read_type(Ast_reader& r, Node_kind k, Cursor& c)
+{
+  Context& cxt = r.cxt;
+  Type_category cat = Type_category(c());
+  Qualifier_set qual = Qualifier_set(c());
+  switch (k) {
+    case Void_type_kind:
+      return Void_type::make(cxt, cat, qual);
+    case Boolean_type_kind:
+      return Boolean_type::make(cxt, cat, qual);
+    case Byte_type_kind:
+      return Byte_type::make(cxt, cat, qual);
+    case Integer_type_kind: {
+      bool sign = c();
+      int prec = c();
+      return Integer_type::make(cxt, cat, sign, prec, qual);
+    }
+    case Float_type_kind: {
+      int prec = c();
+      return Float_type::make(cxt, cat, prec, qual);
+    }
+    case Function_type_kind: {
+      Type_list ps = r.list<Type>(c);
+      Type& ret = r.get<Type>(c());
+      return Function_type::make(cxt, cat, std::move(ps), ret, qual);
+    }
+    case Array_type_kind: {
+      Type& t = r.get<Type>(c());
+      Expr& e = r.get<Expr>(c());
+      return Array_type::make(cxt, cat, t, e);
+    }
+    case Tuple_type_kind: {
+      Type_list ts = r.list<Type>(c);
+      return Tuple_type::make(cxt, cat, ts);
+    }
+    case Pointer_type_kind: {
+      Type& t = r.get<Type>(c());
+      return Pointer_type::make(cxt, cat, t, qual);
+    }
+    case Class_type_kind: {
+      Decl& d = r.get<Decl>(c());
+      return Class_type::make(cxt, cat, d, qual);
+    }
+    default:
+      r.malformed();
+  }
+}
+
+
+template<typename T>
+static T&
+read_unary(Ast_reader& r, Type& t, Cursor& c)
+{
+  Expr& e = r.get<Expr>(c());
+  T& x = T::make(r.cxt, t, e);
+  x.res_ = r.get_optional<Decl>(c());
+  return x;
+}
+
+
+template<typename T>
+static T&
+read_binary(Ast_reader& r, Type& t, Cursor& c)
+{
+  Expr& e1 = r.get<Expr>(c());
+  Expr& e2 = r.get<Expr>(c());
+  T& x = T::make(r.cxt, t, e1, e2);
+  x.res_ = r.get_optional<Decl>(c());
+  return x;
+}
+
+
+// Conversions and initializers of a single expression.
+template<typename T>
+static T&
+read_conversion(Ast_reader& r, Type& t, Cursor& c)
+{
+  Expr& e = r.get<Expr>(c());
+  return T::make(r.cxt, t, e);
+}
+
+
+static Expr&
+read_expr(Ast_reader& r, Node_kind k, Cursor& c)
+{
+  Context& cxt = r.cxt;
+  Type& t = r.get<Type>(c());
+  switch (k) {
+    case Void_expr_kind:
+      return Void_expr::make(cxt, t);
+    case Boolean_expr_kind:
+      return Boolean_expr::make(cxt, t, c());
+    case Integer_expr_kind: {
+      unsigned bits = c();
+      bool uns = c();
+      if (bits == 0 || bits > llvm::APInt::MAX_INT_BITS)
+        r.malformed();
+      std::vector<std::uint64_t> ws((bits + 63) / 64);
+      for (std::uint64_t& w : ws) {
+        std::uint64_t lo = c();
+        std::uint64_t hi = c();
+        w = lo | hi << 32;
+      }
+      llvm::APSInt n(llvm::APInt(bits, ws), uns);
+      return Integer_expr::make(cxt, t, Integer(n));
+    }
+    case Tuple_expr_kind: {
+      Expr_list es = r.list<Expr>(c);
+      return Tuple_expr::make(cxt, t, es);
+    }
+    case Decl_ref_kind: {
+      Name& n = r.get<Name>(c());
+      Decl& d = r.get<Decl>(c());
+      return Decl_ref::make(cxt, t, n, d);
+    }
+
+    case Add_expr_kind: return read_binary<Add_expr>(r, t, c);
+    case Sub_expr_kind: return read_binary<Sub_expr>(r, t, c);
+    case Mul_expr_kind: return read_binary<Mul_expr>(r, t, c);
+    case Div_expr_kind: return read_binary<Div_expr>(r, t, c);
+    case Rem_expr_kind: return read_binary<Rem_expr>(r, t, c);
+    case Neg_expr_kind: return read_unary<Neg_expr>(r, t, c);
+    case Pos_expr_kind: return read_unary<Pos_expr>(r, t, c);
+    case Bit_and_expr_kind: return read_binary<Bit_and_expr>(r, t, c);
+    case Bit_or_expr_kind: return read_binary<Bit_or_expr>(r, t, c);
+    case Bit_xor_expr_kind: return read_binary<Bit_xor_expr>(r, t, c);
+    case Bit_lsh_expr_kind: return read_binary<Bit_lsh_expr>(r, t, c);
+    case Bit_rsh_expr_kind: return read_binary<Bit_rsh_expr>(r, t, c);
+    case Bit_not_expr_kind: return read_unary<Bit_not_expr>(r, t, c);
+    case Eq_expr_kind: return read_binary<Eq_expr>(r, t, c);
+    case Ne_expr_kind: return read_binary<Ne_expr>(r, t, c);
+    case Lt_expr_kind: return read_binary<Lt_expr>(r, t, c);
+    case Gt_expr_kind: return read_binary<Gt_expr>(r, t, c);
+    case Le_expr_kind: return read_binary<Le_expr>(r, t, c);
+    case Ge_expr_kind: return read_binary<Ge_expr>(r, t, c);
+    case Cmp_expr_kind: return read_binary<Cmp_expr>(r, t, c);
+    case And_expr_kind: return read_binary<And_expr>(r, t, c);
+    case Or_expr_kind: return read_binary<Or_expr>(r, t, c);
+    case Not_expr_kind: return read_unary<Not_expr>(r, t, c);
+    case Assign_expr_kind: return read_binary<Assign_expr>(r, t, c);
+
+    case Call_expr_kind: {
+      Expr& f = r.get<Expr>(c());
+      Expr_list args = r.list<Expr>(c);
+      Call_expr& e = Call_expr::make(cxt, t, f, args);
+      e.res_ = r.get_optional<Decl>(c());
+      return e;
+    }
+
+    case Value_conv_kind: return read_conversion<Value_conv>(r, t, c);
+    case Qualification_conv_kind: return read_conversion<Qualification_conv>(r, t, c);
+    case Boolean_conv_kind: return read_conversion<Boolean_conv>(r, t, c);
+    case Integer_conv_kind: return read_conversion<Integer_conv>(r, t, c);
+    case Float_conv_kind: return read_conversion<Float_conv>(r, t, c);
+    case Numeric_conv_kind: return read_conversion<Numeric_conv>(r, t, c);
+    case Dependent_conv_kind: return read_conversion<Dependent_conv>(r, t, c);
+    case Ellipsis_conv_kind: return read_conversion<Ellipsis_conv>(r, t, c);
+
+    case Trivial_init_kind:
+      return Trivial_init::make(cxt, t);
+    case Copy_init_kind:
+      return read_conversion<Copy_init>(r, t, c);
+    case Bind_init_kind:
+      return read_conversion<Bind_init>(r, t, c);
+    case Direct_init_kind: {
+      Decl& d = r.get<Decl>(c());
+      Expr_list args = r.list<Expr>(c);
+      return Direct_init::make(cxt, t, d, args);
+    }
+    case Aggregate_init_kind: {
+      Expr_list es = r.list<Expr>(c);
+      return Aggregate_init::make(cxt, t, std::move(es));
+    }
+    default:
+      r.malformed();
+  }
+}
+
+
+static Stmt&
+read_stmt(Ast_reader& r, Node_kind k, Cursor& c)
+{
+  Context& cxt = r.cxt;
+  switch (k) {
+    case Empty_stmt_kind:
+      return Empty_stmt::make(cxt);
+    case Return_stmt_kind:
+      return Return_stmt::make(cxt);
+    case Yield_stmt_kind:
+      return Yield_stmt::make(cxt);
+    case Break_stmt_kind:
+      return Break_stmt::make(cxt);
+    case Continue_stmt_kind:
+      return Continue_stmt::make(cxt);
+    case Compound_stmt_kind: {
+      Stmt_list ss = r.list<Stmt>(c);
+      return Compound_stmt::make(cxt, std::move(ss));
+    }
+    case Expression_stmt_kind:
+      return Expression_stmt::make(cxt, r.get<Expr>(c()));
+    case Declaration_stmt_kind:
+      return Declaration_stmt::make(cxt, r.get<Decl>(c()));
+    case Return_value_stmt_kind:
+      return Return_value_stmt::make(cxt, r.get<Expr>(c()));
+    case Yield_value_stmt_kind:
+      return Yield_value_stmt::make(cxt, r.get<Expr>(c()));
+    case If_then_stmt_kind: {
+      Expr& e = r.get<Expr>(c());
+      Stmt& s = r.get<Stmt>(c());
+      return If_then_stmt::make(cxt, e, s);
+    }
+    case If_else_stmt_kind: {
+      Expr& e = r.get<Expr>(c());
+      Stmt& s1 = r.get<Stmt>(c());
+      Stmt& s2 = r.get<Stmt>(c());
+      return If_else_stmt::make(cxt, e, s1, s2);
+    }
+    case While_stmt_kind: {
+      Expr& e = r.get<Expr>(c());
+      Stmt& s = r.get<Stmt>(c());
+      Loop_hints h;
+      h.vectorize = c();
+      h.unroll = c();
+      return While_stmt::make(cxt, e, s, h);
+    }
+    default:
+      r.malformed();
+  }
+}
+
+
+// Declarations are created with placeholder types and definitions,
+// and registered as node n before their fields are read. This allows
+// the fields to refer to the declaration.
+//
+// Exported variables and functions are external. Their definitions
+// are left empty, so that the nodes of function bodies and variable
+// initializers are never read.
+static Decl&
+read_decl(Ast_reader& r, std::uint32_t n, Node_kind k, Cursor& c)
+{
+  Context& cxt = r.cxt;
+  if (k == Translation_unit_kind)
+    return cxt.translation_unit();
+
+  Name& name = r.get<Name>(c());
+  Specifier_set spec = Specifier_set(c());
+  std::uint32_t dc = c();
+  auto enter = [&](Decl& d) {
+    r.nodes[n] = &d;
+    d.cxt_ = r.get_optional<Decl>(dc);
+  };
+  bool external = r.exported[n] && (k == Variable_decl_kind || k == Function_decl_kind);
+  if (external)
+    spec |= extern_spec;
+
+  switch (k) {
+    case Variable_decl_kind: {
+      Variable_decl& d = Variable_decl::make(cxt, name, cxt.get_void_type(), cxt.make_empty_definition(), spec);
+      enter(d);
+      d.type_ = &r.get<Type>(c());
+      std::uint32_t def = c();
+      if (!external)
+        d.def_ = &r.get<Def>(def);
+      return d;
+    }
+    case Function_decl_kind: {
+      Function_decl& d = Function_decl::make(cxt, name, cxt.get_void_type(), Decl_list{}, cxt.make_empty_definition(), spec);
+      enter(d);
+      d.type_ = &r.get<Type>(c());
+      d.parms_ = r.list<Decl>(c);
+      std::uint32_t def = c();
+      if (!external)
+        d.def_ = &r.get<Def>(def);
+      d.call_ = &cxt.synthesize_call_operator(d);
+      return d;
+    }
+    case Class_decl_kind: {
+      Class_decl& d = Class_decl::make(cxt, name, cxt.make_empty_definition());
+      d.spec_ = spec;
+      enter(d);
+      d.def_ = &r.get<Def>(c());
+      return d;
+    }
+    case Variable_parm_kind: {
+      Variable_parm& d = Variable_parm::make(cxt, name, cxt.get_void_type(), cxt.make_empty_definition(), spec);
+      enter(d);
+      d.type_ = &r.get<Type>(c());
+      d.def_ = &r.get<Def>(c());
+      int depth = c();
+      int offset = c();
+      d.ix_ = Index(depth, offset);
+      return d;
+    }
+    default:
+      r.malformed();
+  }
+}
+
+
+static Def&
+read_def(Ast_reader& r, Node_kind k, Cursor& c)
+{
+  Context& cxt = r.cxt;
+  switch (k) {
+    case Empty_def_kind:
+      return cxt.make_empty_definition();
+    case Deleted_def_kind:
+      return cxt.make_deleted_definition();
+    case Defaulted_def_kind:
+      return cxt.make_defaulted_definition();
+    case Expression_def_kind:
+      return cxt.make_expression_definition(r.get<Expr>(c()));
+    case Function_def_kind:
+      return cxt.make_function_definition(r.get<Stmt>(c()));
+    case Class_def_kind: {
+      Stmt_list ss = r.list<Stmt>(c);
+      Class_def& d = cxt.make_class_definition(std::move(ss));
+      d.bases_ = r.list<Decl>(c);
+      d.objs_ = r.list<Decl>(c);
+      return d;
+    }
+    default:
+      r.malformed();
+  }
+}
+
+
+// Map the file into memory. If the file cannot be read, is not a
+// binary AST of this version, or its tables are not within the file,
+// an error is diagnosed and the reader is invalid.
+Ast_reader::Ast_reader(Context& c, String const& p)
+  : cxt(c), path(p), base(nullptr), size(0)
+{
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    lingo::error("cannot open '{}' for reading", path);
+    return;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(Ast_header)) {
+    void* p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p != MAP_FAILED) {
+      base = (char const*)p;
+      size = st.st_size;
+    }
+  }
+  ::close(fd);
+
+  if (!base || header().magic != ast_magic) {
+    lingo::error("'{}' is not a Banjo AST file", path);
+  } else if (header().version != ast_version) {
+    lingo::error("'{}' has an unsupported version ({})", path, header().version);
+  } else if (!validate()) {
+    lingo::error("'{}' is truncated or malformed", path);
+  } else {
+    nodes.resize(header().nodes);
+    reading.resize(header().nodes);
+    exported.resize(header().nodes);
+    symbols.resize(header().strings);
+    std::uint32_t const* p = words(header().export_offset);
+    for (std::uint32_t i = 0; i < header().exports; ++i, p += 2)
+      exported[p[1]] = true;
+    return;
+  }
+  if (base)
+    ::munmap((void*)base, size);
+  base = nullptr;
+}
+
+
+Ast_reader::~Ast_reader()
+{
+  if (base)
+    ::munmap((void*)base, size);
+}
+
+
+Ast_header const&
+Ast_reader::header() const
+{
+  return *(Ast_header const*)base;
+}
+
+
+// Returns the words at the given offset in the file.
+std::uint32_t const*
+Ast_reader::words(std::uint32_t off) const
+{
+  return (std::uint32_t const*)(base + off);
+}
+
+
+// Returns true if the tables are in order and within the file, and
+// every offset and count in them is within its own table. Records
+// are validated as they are read.
+bool
+Ast_reader::validate() const
+{
+  Ast_header const& h = header();
+  if (h.string_offset % 4 || h.node_offset % 4 || h.index_offset % 4 || h.export_offset % 4)
+    return false;
+  std::uint64_t strs = h.string_offset + 4ull * h.strings;
+  std::uint64_t index = h.index_offset + 4ull * h.nodes;
+  std::uint64_t exports = h.export_offset + 8ull * h.exports;
+  if (h.string_offset < sizeof(Ast_header) 
+      || strs > h.node_offset 
+      || h.node_offset > h.index_offset
+      || index > h.export_offset 
+      || exports > size)
+    return false;
+  if (h.root == 0 || h.root >= h.nodes)
+    return false;
+
+  // Each string is its length followed by its characters, after the
+  // offsets and before the node records.
+  std::uint32_t const* offs = words(h.string_offset);
+  for (std::uint32_t i = 0; i < h.strings; ++i) {
+    std::uint64_t off = offs[i];
+    if (off % 4 || off < strs || off + 4 > h.node_offset)
+      return false;
+    if (off + 4 + *words(off) > h.node_offset)
+      return false;
+  }
+
+  // Each record starts within the node records. Node 0 has none.
+  std::uint64_t records = (h.index_offset - h.node_offset) / 4;
+  std::uint32_t const* ix = words(h.index_offset);
+  for (std::uint32_t n = 1; n < h.nodes; ++n) {
+    if (ix[n] >= records)
+      return false;
+  }
+
+  // Each export names a string and a node.
+  std::uint32_t const* p = words(h.export_offset);
+  for (std::uint32_t i = 0; i < h.exports; ++i, p += 2) {
+    if (p[0] >= h.strings || p[1] == 0 || p[1] >= h.nodes)
+      return false;
+  }
+  return true;
+}
+
+
+// Diagnose a malformed record and abandon the import.
+void
+Ast_reader::malformed()
+{
+  error(cxt, "'{}' is malformed", path);
+  throw Import_error("malformed import");
+}
+
+
+// Returns a cursor at the start of the record of node n. The cursor
+// is limited to the node records.
+Ast_reader::Cursor
+Ast_reader::record(std::uint32_t n)
+{
+  std::uint32_t const* index = words(header().index_offset);
+  std::uint32_t const* first = words(header().node_offset);
+  return {*this, first + index[n], words(header().index_offset)};
+}
+
+
+// Returns node n, reading it if needed. A record that refers to itself
+// before it is created is malformed. Declarations are created before
+// their fields are read, so they can refer to themselves.
+Term&
+Ast_reader::node(std::uint32_t n)
+{
+  if (n == 0 || n >= nodes.size())
+    malformed();
+  if (!nodes[n]) {
+    if (reading[n])
+      malformed();
+    reading[n] = true;
+    nodes[n] = &read(n);
+  }
+  return *nodes[n];
+}
+
+
+// Read the record of node n. The category of the node is determined
+// by the range of its kind.
+Term&
+Ast_reader::read(std::uint32_t n)
+{
+  Cursor c = record(n);
+  Node_kind k = Node_kind(c());
+  if (k == null_kind || k >= last_kind)
+    malformed();
+  if (k < Void_type_kind)
+    return read_name(*this, k, c);
+  if (k < Void_expr_kind)
+    return read_type(*this, k, c);
+  if (k < Empty_stmt_kind)
+    return read_expr(*this, k, c);
+  if (k < Translation_unit_kind)
+    return read_stmt(*this, k, c);
+  if (k < Empty_def_kind)
+    return read_decl(*this, n, k, c);
+  return read_def(*this, k, c);
+}
+
+
+// Returns the symbol for string n.
+Symbol const&
+Ast_reader::symbol(std::uint32_t n)
+{
+  if (n >= symbols.size())
+    malformed();
+  if (!symbols[n]) {
+    std::uint32_t off = words(header().string_offset)[n];
+    std::uint32_t const* p = words(off);
+    String s((char const*)(p + 1), *p);
+    symbols[n] = &cxt.get_identifier(s.c_str());
+  }
+  return *symbols[n];
+}
+
+
+// Returns the exported declarations with the given name, reading
+// only those declarations and the nodes they refer to. Variables and
+// functions are external declarations. The declarations are not
+// declared in any scope.
+Decl_list
+Ast_reader::lookup(String const& name)
+{
+  Decl_list ds;
+  std::uint32_t const* p = words(header().export_offset);
+  for (std::uint32_t i = 0; i < header().exports; ++i, p += 2) {
+    if (symbol(p[0]).spelling() == name)
+      ds.push_back(get<Decl>(p[1]));
+  }
+  return ds;
+}
+
+
+} // namespace banjo
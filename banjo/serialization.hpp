@@ -0,0 +1,198 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#ifndef BANJO_SERIALIZATION_HPP
+#define BANJO_SERIALIZATION_HPP
+
+// A compact binary format for elaborated translation units. The format
+// is a sequence of 32-bit words in the byte order of the host:
+//
+//    header   -- magic, version, and the location of each table
+//    strings  -- the offset of each string, followed by the strings
+//    nodes    -- the record of each node
+//    index    -- the offset of each record, in words from the first
+//    exports  -- the name and node of each top-level declaration
+//
+// Each record starts with the kind of node, followed by its fields.
+// Nodes refer to other nodes by id, and to identifiers by their index
+// in the string table, so the file can be used in place, wherever it
+// is mapped. Node 0 is the null node.
+//
+// The reader maps the file into memory and builds nodes on demand, so
+// that declarations can be imported without lexing or parsing, and
+// without loading the declarations that are not used. Only the
+// declarations of exported variables and functions are imported.
+// They are external: their definitions are generated with the
+// translation unit that was written, and are never read.
+
+#include "prelude.hpp"
+#include "ast.hpp"
+#include "error.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+
+namespace banjo
+{
+
+struct Context;
+
+
+// Identifies a binary AST file. This is "BNJO" in little-endian order.
+constexpr std::uint32_t ast_magic = 0x4f4a4e42;
+
+// Incremented each time the format changes.
+constexpr std::uint32_t ast_version = 2;
+
+
+// The header of a binary AST file. All offsets are in bytes from the
+// start of the file.
+struct Ast_header
+{
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint32_t strings;       // The number of strings
+  std::uint32_t string_offset; // The offset of the string table
+  std::uint32_t nodes;         // The number of nodes, including null
+  std::uint32_t node_offset;   // The offset of the node records
+  std::uint32_t index_offset;  // The offset of the node index
+  std::uint32_t exports;       // The number of exported declarations
+  std::uint32_t export_offset; // The offset of the export table
+  std::uint32_t root;          // The translation unit
+};
+
+
+// Writes translation units in the binary format.
+struct Ast_writer
+{
+  using Record = std::vector<std::uint32_t>;
+
+  Ast_writer();
+
+  bool operator()(Translation_unit const&, String const&);
+
+  std::uint32_t node(Term const&);
+  std::uint32_t node(Term const*);
+  std::uint32_t string(String const&);
+
+  template<typename T>
+  void list(Record&, List<T> const&);
+
+  std::unordered_map<Term const*, std::uint32_t> ids;
+  std::unordered_map<String, std::uint32_t>      strings;
+  std::vector<String>                            spellings;
+  std::vector<std::uint32_t>                     index; // Offsets of records
+  std::vector<std::uint32_t>                     data;  // Node records
+};
+
+
+// Write each node of the list to the record.
+template<typename T>
+inline void
+Ast_writer::list(Record& r, List<T> const& ts)
+{
+  r.push_back(ts.size());
+  for (T const& t : ts)
+    r.push_back(node(t));
+}
+
+
+// Reads translation units from a mapped binary file. Nodes are created
+// in the context when they are first used, and the file remains mapped
+// for the lifetime of the reader.
+//
+// The tables of the file are validated when it is opened. Records are
+// validated as they are read; a malformed record is diagnosed, and an
+// Import_error is thrown.
+struct Ast_reader
+{
+  // Reads the fields of a node record. Fields are never read past
+  // the end of the node table.
+  struct Cursor
+  {
+    std::uint32_t operator()();
+
+    Ast_reader&          r;
+    std::uint32_t const* p;
+    std::uint32_t const* end;
+  };
+
+  Ast_reader(Context&, String const&);
+  ~Ast_reader();
+
+  Ast_reader(Ast_reader const&) = delete;
+  Ast_reader& operator=(Ast_reader const&) = delete;
+
+  explicit operator bool() const { return base; }
+
+  Decl_list lookup(String const&);
+
+  Term& node(std::uint32_t);
+  Symbol const& symbol(std::uint32_t);
+
+  template<typename T>
+  T& get(std::uint32_t);
+
+  template<typename T>
+  T* get_optional(std::uint32_t n) { return n ? &get<T>(n) : nullptr; }
+
+  template<typename T>
+  List<T> list(Cursor&);
+
+  Term& read(std::uint32_t);
+  Cursor record(std::uint32_t);
+  Ast_header const& header() const;
+  std::uint32_t const* words(std::uint32_t) const;
+  bool validate() const;
+  [[noreturn]] void malformed();
+
+  Context&                   cxt;
+  String                     path;     // The name of the file
+  char const*                base;     // The mapped file
+  std::size_t                size;     // The size of the file
+  std::vector<Term*>         nodes;    // Nodes read so far
+  std::vector<bool>          reading;  // Nodes being read
+  std::vector<bool>          exported; // Nodes in the export table
+  std::vector<Symbol const*> symbols;  // Symbols read so far
+};
+
+
+inline std::uint32_t
+Ast_reader::Cursor::operator()()
+{
+  if (p == end)
+    r.malformed();
+  return *p++;
+}
+
+
+// Returns node n, which must be a T.
+template<typename T>
+inline T&
+Ast_reader::get(std::uint32_t n)
+{
+  if (T* t = as<T>(&node(n)))
+    return *t;
+  malformed();
+}
+
+
+// Read a list of nodes from the record.
+template<typename T>
+inline List<T>
+Ast_reader::list(Cursor& c)
+{
+  List<T> ts;
+  std::uint32_t n = c();
+  for (std::uint32_t i = 0; i < n; ++i)
+    ts.push_back(get<T>(c()));
+  return ts;
+}
+
+
+} // namespace banjo
+
+
+#endif
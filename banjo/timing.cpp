@@ -0,0 +1,69 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#include "timing.hpp"
+#include "context.hpp"
+
+
+namespace banjo
+{
+
+Time_trace::Time_trace()
+  : on(false), origin(Clock::now())
+{ }
+
+
+// Returns the number of microseconds since the start of the trace.
+double
+Time_trace::now() const
+{
+  std::chrono::duration<double, std::micro> t = Clock::now() - origin;
+  return t.count();
+}
+
+
+// Append the event to the trace, assigning it the number of the
+// current thread. Threads are numbered in order of their first event.
+void
+Time_trace::record(Trace_event& e)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  auto ins = threads.emplace(std::this_thread::get_id(), threads.size());
+  e.thread = ins.first->second;
+  evs.push_back(e);
+}
+
+
+Time_scope::Time_scope(Context& c, char const* n)
+  : cxt(c), ev(), clock()
+{
+  Time_trace& trace = cxt.time_trace();
+  if (!trace.enabled())
+    return;
+  ev.name = n;
+  ev.start = trace.now();
+  ev.bytes = cxt.allocated();
+  clock = std::clock();
+}
+
+
+Time_scope::Time_scope(Context& c, char const* n, Decl const& d)
+  : Time_scope(c, n)
+{
+  ev.decl = &d;
+}
+
+
+Time_scope::~Time_scope()
+{
+  Time_trace& trace = cxt.time_trace();
+  if (!trace.enabled() || !ev.name)
+    return;
+  ev.wall = trace.now() - ev.start;
+  ev.cpu = double(std::clock() - clock) * 1e6 / CLOCKS_PER_SEC;
+  ev.bytes = cxt.allocated() - ev.bytes;
+  trace.record(ev);
+}
+
+
+} // namespace banjo
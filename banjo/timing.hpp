@@ -0,0 +1,87 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#ifndef BANJO_TIMING_HPP
+#define BANJO_TIMING_HPP
+
+// Facilities for measuring where translation time goes. A time trace
+// records a span for each phase of translation and, within phases, for
+// each function or concept processed. Spans are only recorded when the
+// trace is enabled.
+
+#include "prelude.hpp"
+
+#include <chrono>
+#include <ctime>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+namespace banjo
+{
+
+struct Context;
+struct Decl;
+
+
+// A span of translation. Times are in microseconds, and the start of
+// the span is relative to the start of the trace. Bytes are those
+// allocated by the context during the span.
+struct Trace_event
+{
+  char const* name;   // The phase (e.g., "parse")
+  Decl const* decl;   // The entity translated, if any
+  double      start;  // Wall time at the start of the span
+  double      wall;   // Wall time
+  double      cpu;    // Processor time
+  std::size_t bytes;  // Bytes allocated
+  int         thread; // The translating thread
+};
+
+
+// A sequence of recorded spans. Spans may be recorded concurrently
+// by parallel code generation.
+struct Time_trace
+{
+  using Clock = std::chrono::steady_clock;
+  using Thread_map = std::unordered_map<std::thread::id, int>;
+
+  Time_trace();
+
+  bool enabled() const { return on; }
+  void enable(bool b)  { on = b; }
+
+  double now() const;
+  void record(Trace_event&);
+
+  std::vector<Trace_event> const& events() const { return evs; }
+
+  bool                     on;
+  Clock::time_point        origin;
+  std::vector<Trace_event> evs;
+  Thread_map               threads;
+  std::mutex               lock;
+};
+
+
+// An RAII class that records a span of translation from its
+// construction to its destruction. Note that processor time is
+// that of the entire process, not the current thread.
+struct Time_scope
+{
+  Time_scope(Context&, char const*);
+  Time_scope(Context&, char const*, Decl const&);
+  ~Time_scope();
+
+  Context&     cxt;
+  Trace_event  ev;
+  std::clock_t clock;
+};
+
+
+} // namespace banjo
+
+
+#endif
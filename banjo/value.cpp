@@ -4,12 +4,131 @@
 #include "value.hpp"
 #include "ast.hpp"
 
+#include <llvm/ADT/SmallString.h>
+
 #include <iostream>
 
 
 namespace banjo
 {
 
+// -------------------------------------------------------------------------- //
+// Aggregate storage
+
+namespace
+{
+
+// The largest number of elements in an aggregate whose storage is
+// recycled instead of being returned to the system.
+constexpr std::size_t small_aggregate = 4;
+
+
+// Returns the number of bytes needed to store an aggregate of n
+// elements.
+inline std::size_t
+aggregate_size(std::size_t n)
+{
+  return sizeof(Aggregate_value::Rep) + n * sizeof(Value);
+}
+
+
+// A pool of released small aggregate blocks, indexed by the number of
+// elements in the block. Released blocks are threaded through their
+// first word. 
+//
+// The pool is thread-local so that aggregates can be created and 
+// destroyed without synchronization.
+struct Aggregate_pool
+{
+  ~Aggregate_pool();
+
+  void* get(std::size_t);
+  void  put(void*, std::size_t);
+
+  void* free[small_aggregate + 1] = {};
+};
+
+
+Aggregate_pool::~Aggregate_pool()
+{
+  for (void* p : free) {
+    while (p) {
+      void* next = *static_cast<void**>(p);
+      ::operator delete(p);
+      p = next;
+    }
+  }
+}
+
+
+// Returns a block of storage for n elements.
+inline void*
+Aggregate_pool::get(std::size_t n)
+{
+  if (n <= small_aggregate && free[n]) {
+    void* p = free[n];
+    free[n] = *static_cast<void**>(p);
+    return p;
+  }
+  return ::operator new(aggregate_size(n));
+}
+
+
+// Release the block of storage for n elements.
+inline void
+Aggregate_pool::put(void* p, std::size_t n)
+{
+  if (n <= small_aggregate) {
+    *static_cast<void**>(p) = free[n];
+    free[n] = p;
+    return;
+  }
+  ::operator delete(p);
+}
+
+
+thread_local Aggregate_pool pool;
+
+
+} // namespace
+
+
+// Allocate a new, unshared representation with n error values.
+Aggregate_value::Rep*
+Aggregate_value::Rep::make(std::size_t n)
+{
+  lingo_assert(n <= UINT32_MAX);
+  Rep* r = new (pool.get(n)) Rep{1, std::uint32_t(n)};
+  Value* p = r->data();
+  for (std::size_t i = 0; i < n; ++i)
+    new (p + i) Value();
+  return r;
+}
+
+
+// Destroy the elements of r and release its storage.
+void
+Aggregate_value::Rep::unmake(Rep* r)
+{
+  std::size_t n = r->size;
+  Value* p = r->data();
+  for (std::size_t i = 0; i < n; ++i)
+    p[i].~Value();
+  pool.put(r, n);
+}
+
+
+// Give this aggregate its own copy of the shared elements.
+void
+Aggregate_value::detach()
+{
+  Rep* r = Rep::make(rep_->size);
+  std::copy(rep_->data(), rep_->data() + rep_->size, r->data());
+  --rep_->refs;
+  rep_ = r;
+}
+
+
 // Return a string value for the aggregate. This is needed for any
 // transformation to narrow string literals in the evaluation
 // character set.
@@ -42,6 +161,15 @@ print(std::ostream& os, Aggregate_value const& v)
 }
 
 
+inline void
+print(std::ostream& os, Wide_value const& v)
+{
+  llvm::SmallString<64> str;
+  v.get().toString(str, 10);
+  os << str.str().str();
+}
+
+
 std::ostream&
 operator<<(std::ostream& os, Value const& v)
 {
@@ -52,6 +180,7 @@ operator<<(std::ostream& os, Value const& v)
     void operator()(Error_value const& v)     { os << "<error>"; }
     void operator()(Void_value const& v)      { os << "<void>"; };
     void operator()(Integer_value const& v)   { os << v; };
+    void operator()(Wide_value const& v)      { print(os, v); };
     void operator()(Float_value const& v)     { os << v; };
     void operator()(Aggregate_value const& v) { print(os, v); }
     void operator()(Reference_value const& v) { os << '@' << v; };
@@ -61,6 +190,241 @@ operator<<(std::ostream& os, Value const& v)
 }
 
 
+// -------------------------------------------------------------------------- //
+// Integer arithmetic
+
+namespace
+{
+
+// Returns true if the signed value n is representable in p bits.
+inline bool
+fits_signed(std::int64_t n, int p)
+{
+  if (p >= 64)
+    return true;
+  std::int64_t min = -(std::int64_t(1) << (p - 1));
+  std::int64_t max = (std::int64_t(1) << (p - 1)) - 1;
+  return min <= n && n <= max;
+}
+
+
+// Reduce n modulo 2^p.
+inline std::int64_t
+wrap_unsigned(std::uint64_t n, int p)
+{
+  if (p >= 64)
+    return n;
+  return n & ((std::uint64_t(1) << p) - 1);
+}
+
+
+// Compute the result of an arithmetic operation. The checked function
+// computes the signed 64-bit result and returns true on overflow. The
+// wrapped function computes the unsigned result modulo 2^64. The wide 
+// function computes the result over wide integers, setting its last
+// argument on signed overflow.
+//
+// The common case, both operands inline and no overflow, requires only
+// the checked operation and a range test.
+template<typename Checked, typename Wrapped, typename Wide>
+inline Value
+arithmetic(Integer_spec s, Value const& a, Value const& b, Checked chk, Wrapped wrap, Wide wide)
+{
+  if (a.is_integer() && b.is_integer()) {
+    std::int64_t x = a.get_integer();
+    std::int64_t y = b.get_integer();
+    std::int64_t r;
+
+    // Narrow types never promote. Unsigned results wrap.
+    if (s.precision <= 64) {
+      if (!s.is_signed)
+        return wrap_unsigned(wrap(x, y), s.precision);
+      if (chk(x, y, &r) || !fits_signed(r, s.precision))
+        return Value();
+      return r;
+    }
+
+    // For wide types, an inline value is exact. If the result is
+    // representable, we're done. Note that negative unsigned results
+    // wrap to very large values, so they also require promotion.
+    if (!chk(x, y, &r) && (s.is_signed || r >= 0))
+      return r;
+  }
+
+  // Otherwise, compute the wide result.
+  llvm::APSInt x = get_wide_integer(s, a);
+  llvm::APSInt y = get_wide_integer(s, b);
+  bool overflow = false;
+  llvm::APSInt r(wide(x, y, overflow), !s.is_signed);
+  if (s.is_signed && overflow)
+    return Value();
+  return make_integer(s, r);
+}
+
+
+// Returns true if v is an integer 0.
+inline bool
+is_zero(Value const& v)
+{
+  return v.is_integer() && v.get_integer() == 0;
+}
+
+
+} // namespace
+
+
+// Returns the value of the integer n in the representation required
+// by the spec s. The value is converted to the precision of s.
+Value
+make_integer(Integer_spec s, llvm::APSInt const& n)
+{
+  llvm::APSInt v = n.extOrTrunc(s.precision);
+  v.setIsSigned(s.is_signed);
+  if (s.precision <= 64) {
+    if (s.is_signed)
+      return Integer_value(v.getSExtValue());
+    else
+      return Integer_value(v.getZExtValue());
+  }
+  if (s.is_signed && v.getMinSignedBits() <= 64)
+    return Integer_value(v.getSExtValue());
+  if (!s.is_signed && v.getActiveBits() < 64)
+    return Integer_value(v.getZExtValue());
+  return Wide_value(v);
+}
+
+
+// Returns the integer value v as a wide integer with the precision
+// and signedness of s.
+llvm::APSInt
+get_wide_integer(Integer_spec s, Value const& v)
+{
+  if (v.is_wide()) {
+    llvm::APSInt n = v.get_wide().get().extOrTrunc(s.precision);
+    n.setIsSigned(s.is_signed);
+    return n;
+  }
+  llvm::APInt n(s.precision, v.get_integer(), true);
+  return llvm::APSInt(n, !s.is_signed);
+}
+
+
+Value
+integer_add(Integer_spec s, Value const& a, Value const& b)
+{
+  auto chk = [](std::int64_t x, std::int64_t y, std::int64_t* r) {
+    return __builtin_add_overflow(x, y, r);
+  };
+  auto wrap = [](std::uint64_t x, std::uint64_t y) {
+    return x + y;
+  };
+  auto wide = [s](llvm::APSInt const& x, llvm::APSInt const& y, bool& ovf) {
+    return s.is_signed ? x.sadd_ov(y, ovf) : x.uadd_ov(y, ovf);
+  };
+  return arithmetic(s, a, b, chk, wrap, wide);
+}
+
+
+Value
+integer_sub(Integer_spec s, Value const& a, Value const& b)
+{
+  auto chk = [](std::int64_t x, std::int64_t y, std::int64_t* r) {
+    return __builtin_sub_overflow(x, y, r);
+  };
+  auto wrap = [](std::uint64_t x, std::uint64_t y) {
+    return x - y;
+  };
+  auto wide = [s](llvm::APSInt const& x, llvm::APSInt const& y, bool& ovf) {
+    return s.is_signed ? x.ssub_ov(y, ovf) : x.usub_ov(y, ovf);
+  };
+  return arithmetic(s, a, b, chk, wrap, wide);
+}
+
+
+Value
+integer_mul(Integer_spec s, Value const& a, Value const& b)
+{
+  auto chk = [](std::int64_t x, std::int64_t y, std::int64_t* r) {
+    return __builtin_mul_overflow(x, y, r);
+  };
+  auto wrap = [](std::uint64_t x, std::uint64_t y) {
+    return x * y;
+  };
+  auto wide = [s](llvm::APSInt const& x, llvm::APSInt const& y, bool& ovf) {
+    return s.is_signed ? x.smul_ov(y, ovf) : x.umul_ov(y, ovf);
+  };
+  return arithmetic(s, a, b, chk, wrap, wide);
+}
+
+
+// Division by zero yields an error.
+Value
+integer_div(Integer_spec s, Value const& a, Value const& b)
+{
+  if (is_zero(b))
+    return Value();
+  auto chk = [](std::int64_t x, std::int64_t y, std::int64_t* r) {
+    if (x == INT64_MIN && y == -1)
+      return true;
+    *r = x / y;
+    return false;
+  };
+  auto wrap = [](std::uint64_t x, std::uint64_t y) {
+    return x / y;
+  };
+  auto wide = [s](llvm::APSInt const& x, llvm::APSInt const& y, bool& ovf) {
+    return s.is_signed ? x.sdiv_ov(y, ovf) : x.udiv(y);
+  };
+  return arithmetic(s, a, b, chk, wrap, wide);
+}
+
+
+// The remainder of division by zero is an error.
+Value
+integer_rem(Integer_spec s, Value const& a, Value const& b)
+{
+  if (is_zero(b))
+    return Value();
+  auto chk = [](std::int64_t x, std::int64_t y, std::int64_t* r) {
+    *r = (y == -1) ? 0 : x % y;
+    return false;
+  };
+  auto wrap = [](std::uint64_t x, std::uint64_t y) {
+    return x % y;
+  };
+  auto wide = [s](llvm::APSInt const& x, llvm::APSInt const& y, bool& ovf) {
+    return s.is_signed ? x.srem(y) : x.urem(y);
+  };
+  return arithmetic(s, a, b, chk, wrap, wide);
+}
+
+
+// Negation is computed as 0 - n.
+Value
+integer_neg(Integer_spec s, Value const& n)
+{
+  return integer_sub(s, Value(0), n);
+}
+
+
+// Returns a negative value if a < b, a positive value if a > b, and
+// 0 when the values are equal.
+int
+integer_compare(Integer_spec s, Value const& a, Value const& b)
+{
+  if (a.is_integer() && b.is_integer()) {
+    std::int64_t x = a.get_integer();
+    std::int64_t y = b.get_integer();
+    if (s.precision <= 64 && !s.is_signed)
+      return (std::uint64_t(x) > std::uint64_t(y)) - (std::uint64_t(x) < std::uint64_t(y));
+    return (x > y) - (x < y);
+  }
+  llvm::APSInt x = get_wide_integer(s, a);
+  llvm::APSInt y = get_wide_integer(s, b);
+  return (x > y) - (x < y);
+}
+
+
 // -------------------------------------------------------------------------- //
 // Zero initialization
 
@@ -92,14 +456,23 @@ zero_initialize(Aggregate_value& v)
 
 // Zero initialize the value. Note that zero initialization of a
 // reference or function (which would be a reference) does nothing.
+//
+// A wide integer is replaced by an integer 0, which is the
+// representation of 0 for every precision.
 void
 zero_initialize(Value& v)
 {
+  if (v.is_wide()) {
+    v = Value(0);
+    return;
+  }
+
   struct fn
   {
     void operator()(Error_value& v)     { /* Do nothing. */ };
     void operator()(Void_value& v)      { /* Do nothing. */ };
     void operator()(Integer_value& v)   { zero_initialize(v); };
+    void operator()(Wide_value& v)      { lingo_unreachable(); };
     void operator()(Float_value& v)     { zero_initialize(v); };
     void operator()(Aggregate_value& v) { zero_initialize(v); };
     void operator()(Reference_value& v) { /* Do nothing. */ }
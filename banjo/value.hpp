@@ -9,6 +9,9 @@
 
 #include "prelude.hpp"
 
+#include <llvm/ADT/APSInt.h>
+
+#include <cstdint>
 #include <cstring>
 
 
@@ -25,6 +28,7 @@ enum Value_kind
   error_value,     // An object containing an error.
   void_value,      // An object representing a void expression
   integer_value,   // An object containing an integer value
+  wide_value,      // An object containing a wide integer value
   float_value,     // An object containing floating point value
   aggregate_value, // An object containing other objects
   reference_value, // A reference to an object
@@ -40,27 +44,130 @@ struct Void_value { };
 
 
 // Representation of fundamental value categories.
+//
+// An integer value of a type whose precision is 64 bits or less is 
+// always stored as an integer value. For signed types, the value is
+// sign-extended; for unsigned types, it is zero-extended. Note that
+// 64-bit unsigned values are stored as their bit pattern.
+//
+// For types with greater precision, the integer value holds the exact
+// value when it fits in 64 bits. Otherwise the value is wide.
 using Integer_value = int64_t;
 
 
+// An integer value that is not representable as an integer value. 
+// Wide values are immutable, so their representation is shared among
+// copies.
+struct Wide_value
+{
+  struct Rep;
+
+  explicit Wide_value(llvm::APSInt const&);
+
+  // Copy semantics
+  Wide_value(Wide_value const&);
+  Wide_value& operator=(Wide_value const&);
+
+  ~Wide_value();
+
+  llvm::APSInt const& get() const;
+
+  Rep* rep_;
+};
+
+
+struct Wide_value::Rep
+{
+  std::uint32_t refs;
+  llvm::APSInt  num;
+};
+
+
 // Represents a floating point object.
 using Float_value = double;
 
 
 // An aggregation of other values.
 //
+// An aggregate is a handle to a reference-counted block of elements. 
+// Copying an aggregate shares the block; the elements are copied only
+// when a shared aggregate is modified (copy-on-write). This keeps the
+// representation of a value to two words, and makes the loading of
+// aggregate objects during evaluation cheap.
+//
+// Small aggregates (e.g., pairs and triples) are allocated from a
+// recycled pool of blocks so that tuple-heavy evaluations do not
+// continually allocate and release memory. The empty aggregate has
+// no storage at all.
+//
+// Note that non-const access to elements (operator[], begin(), end(),
+// and data()) detaches the aggregate from any other sharing handles.
+// Const access never copies.
+//
 // TODO: Represent compile-time string literal differently?
 //
 // TODO: We need to be careful to not let reference values refer
 // to objects that are no longer live. In other words, we have to
-// avoid dangling references at all costs within the evaluator.
-struct Aggregate_value : std::vector<Value>
+// avoid dangling references at all costs within the evaluator. This
+// is now especially true of references into aggregates, which may be
+// relocated when a shared aggregate is modified.
+struct Aggregate_value
 {
+  struct Rep;
+
+  using iterator       = Value*;
+  using const_iterator = Value const*;
+
+  Aggregate_value();
   Aggregate_value(std::size_t n);
   Aggregate_value(char const*);
   Aggregate_value(char const*, std::size_t n);
 
+  // Copy semantics
+  Aggregate_value(Aggregate_value const&);
+  Aggregate_value& operator=(Aggregate_value const&);
+
+  // Move semantics
+  Aggregate_value(Aggregate_value&&);
+  Aggregate_value& operator=(Aggregate_value&&);
+
+  ~Aggregate_value();
+
+  std::size_t size() const;
+  bool        empty() const { return size() == 0; }
+  bool        is_shared() const;
+
+  Value const& operator[](std::size_t n) const;
+  Value&       operator[](std::size_t n);
+
+  Value const* data() const;
+  Value*       data();
+
+  const_iterator begin() const;
+  const_iterator end() const;
+  iterator       begin();
+  iterator       end();
+
   String get_string() const;
+
+  void detach();
+
+  Rep* rep_;
+};
+
+
+// The shared representation of an aggregate. The elements of the
+// aggregate immediately follow this header in memory.
+struct Aggregate_value::Rep
+{
+  static Rep* make(std::size_t);
+  static void unmake(Rep*);
+
+  Value const* data() const { return reinterpret_cast<Value const*>(this + 1); }
+  Value*       data()       { return reinterpret_cast<Value*>(this + 1); }
+
+  std::uint32_t refs; // The number of handles sharing this block
+  std::uint32_t size; // The number of elements
 };
 
 
@@ -78,6 +185,7 @@ union Value_rep
   Value_rep(Error_value x) : err_(x) { }
   Value_rep(Void_value x) : void_(x) { }
   Value_rep(Integer_value z) : int_(z) { }
+  Value_rep(Wide_value const& z) : wide_(z) { }
   Value_rep(Float_value fp) : float_(fp) { }
   Value_rep(Aggregate_value const& a) : agg_(a) { }
   Value_rep(Aggregate_value&& a) : agg_(std::move(a)) { }
@@ -91,6 +199,7 @@ union Value_rep
   Error_value     err_;
   Void_value      void_;
   Integer_value   int_;
+  Wide_value      wide_;
   Float_value     float_;
   Aggregate_value agg_;
   Reference_value ref_;
@@ -135,6 +244,10 @@ struct Value
     : k(integer_value), r(n)
   { }
 
+  Value(Wide_value const& n)
+    : k(wide_value), r(n)
+  { }
+
   Value(Float_value fp)
     : k(float_value), r(fp)
   { }
@@ -160,6 +273,7 @@ struct Value
   bool is_error() const;
   bool is_void() const;
   bool is_integer() const;
+  bool is_wide() const;
   bool is_float() const;
   bool is_reference() const;
   bool is_aggregate() const;
@@ -168,6 +282,7 @@ struct Value
   Error_value            get_error() const;
   Void_value             get_void() const;
   Integer_value          get_integer() const;
+  Wide_value const&      get_wide() const;
   bool                   get_boolean() const;
   Float_value            get_float() const;
   Aggregate_value const& get_aggregate() const;  
@@ -178,12 +293,18 @@ struct Value
 };
 
 
+// Values are passed and stored by value throughout the evaluator. Keep
+// them small.
+static_assert(sizeof(Value) <= 2 * sizeof(void*), "value is too large");
+
+
 // The non-modifying visitor.
 struct Value::Visitor
 {
   virtual void visit(Error_value const&) = 0;
   virtual void visit(Void_value const&) = 0;
   virtual void visit(Integer_value const&) = 0;
+  virtual void visit(Wide_value const&) = 0;
   virtual void visit(Float_value const&) = 0;
   virtual void visit(Reference_value const&) = 0;
   virtual void visit(Aggregate_value const&) = 0;
@@ -196,6 +317,7 @@ struct Value::Mutator
   virtual void visit(Error_value&) = 0;
   virtual void visit(Void_value&) = 0;
   virtual void visit(Integer_value&) = 0;
+  virtual void visit(Wide_value&) = 0;
   virtual void visit(Float_value&) = 0;
   virtual void visit(Reference_value&) = 0;
   virtual void visit(Aggregate_value&) = 0;
@@ -273,6 +395,14 @@ Value::is_integer() const
 }
 
 
+// Returns true if the value is a wide integer.
+inline bool
+Value::is_wide() const
+{
+  return k == wide_value;
+}
+
+
 // Returns true if the value is an floating point.
 inline bool
 Value::is_float() const
@@ -324,6 +454,15 @@ Value::get_integer() const
 }
 
 
+// Returns the wide integer value.
+inline Wide_value const&
+Value::get_wide() const
+{
+  assert(is_wide());
+  return r.wide_;
+}
+
+
 // Returns the floating point value.
 inline Float_value
 Value::get_float() const
@@ -366,6 +505,7 @@ Value::accept(Visitor& v) const
     case error_value: return v.visit(r.err_);
     case void_value: return v.visit(r.void_);
     case integer_value: return v.visit(r.int_);
+    case wide_value: return v.visit(r.wide_);
     case float_value: return v.visit(r.float_);
     case reference_value: return v.visit(r.ref_);
     case aggregate_value: return v.visit(r.agg_);
@@ -381,6 +521,7 @@ Value::accept(Mutator& v)
     case error_value: return v.visit(r.err_);
     case void_value: return v.visit(r.void_);
     case integer_value: return v.visit(r.int_);
+    case wide_value: return v.visit(r.wide_);
     case float_value: return v.visit(r.float_);
     case reference_value: return v.visit(r.ref_);
     case aggregate_value: return v.visit(r.agg_);
@@ -410,6 +551,10 @@ Value_rep::initialize(Value_rep const& x, Value_kind k)
       new (&int_) Integer_value(x.int_); 
       break;
 
+    case wide_value:
+      new (&wide_) Wide_value(x.wide_); 
+      break;
+
     case float_value:
       new (&float_) Float_value(x.float_); 
       break;
@@ -445,6 +590,10 @@ Value_rep::initialize(Value_rep&& x, Value_kind k)
       new (&int_) Integer_value(std::move(x.int_)); 
       break;
 
+    case wide_value:
+      new (&wide_) Wide_value(x.wide_); 
+      break;
+
     case float_value:
       new (&float_) Float_value(std::move(x.float_)); 
       break;
@@ -480,6 +629,10 @@ Value_rep::destroy(Value_kind k)
       int_.~Integer_value();
       break;
 
+    case wide_value:
+      wide_.~Wide_value();
+      break;
+
     case float_value:
       float_.~Float_value();
       break;
@@ -499,6 +652,50 @@ Value_rep::destroy(Value_kind k)
 
 
 
+// -------------------------------------------------------------------------- //
+// Wide integer implementation
+
+inline
+Wide_value::Wide_value(llvm::APSInt const& n)
+  : rep_(new Rep{1, n})
+{ }
+
+
+inline
+Wide_value::Wide_value(Wide_value const& x)
+  : rep_(x.rep_)
+{
+  ++rep_->refs;
+}
+
+
+inline Wide_value&
+Wide_value::operator=(Wide_value const& x)
+{
+  ++x.rep_->refs;
+  if (--rep_->refs == 0)
+    delete rep_;
+  rep_ = x.rep_;
+  return *this;
+}
+
+
+inline
+Wide_value::~Wide_value()
+{
+  if (--rep_->refs == 0)
+    delete rep_;
+}
+
+
+// Returns the wide integer.
+inline llvm::APSInt const&
+Wide_value::get() const
+{
+  return rep_->num;
+}
+
+
 // -------------------------------------------------------------------------- //
 // Aggregate implementation
 //
@@ -506,23 +703,27 @@ Value_rep::destroy(Value_kind k)
 // it to be a complete type.
 
 
+// Initialize an empty aggregate. No storage is allocated.
+inline
+Aggregate_value::Aggregate_value()
+  : rep_(nullptr)
+{ }
+
+
 // Initialize the aggregate with n error values.
 //
 // TODO: These should be indeterminate values.
 inline
 Aggregate_value::Aggregate_value(std::size_t n)
-  : std::vector<Value>(n)
+  : rep_(n ? Rep::make(n) : nullptr)
 { }
 
 
 // FIXME
 inline
 Aggregate_value::Aggregate_value(char const* s)
-  : Aggregate_value(std::strlen(s) + 1)
-{
-  auto iter = copy(s, s + size(), begin());
-  *iter = Value(0);
-}
+  : Aggregate_value(s, std::strlen(s))
+{ }
 
 
 inline
@@ -534,6 +735,132 @@ Aggregate_value::Aggregate_value(char const* s, std::size_t n)
 }
 
 
+// Share the representation of x.
+inline
+Aggregate_value::Aggregate_value(Aggregate_value const& x)
+  : rep_(x.rep_)
+{
+  if (rep_)
+    ++rep_->refs;
+}
+
+
+inline Aggregate_value&
+Aggregate_value::operator=(Aggregate_value const& x)
+{
+  if (x.rep_)
+    ++x.rep_->refs;
+  if (rep_ && --rep_->refs == 0)
+    Rep::unmake(rep_);
+  rep_ = x.rep_;
+  return *this;
+}
+
+
+inline
+Aggregate_value::Aggregate_value(Aggregate_value&& x)
+  : rep_(x.rep_)
+{
+  x.rep_ = nullptr;
+}
+
+
+inline Aggregate_value&
+Aggregate_value::operator=(Aggregate_value&& x)
+{
+  std::swap(rep_, x.rep_);
+  return *this;
+}
+
+
+inline
+Aggregate_value::~Aggregate_value()
+{
+  if (rep_ && --rep_->refs == 0)
+    Rep::unmake(rep_);
+}
+
+
+// Returns the number of elements in the aggregate.
+inline std::size_t
+Aggregate_value::size() const
+{
+  return rep_ ? rep_->size : 0;
+}
+
+
+// Returns true if the storage of the aggregate is shared with 
+// another aggregate.
+inline bool
+Aggregate_value::is_shared() const
+{
+  return rep_ && rep_->refs > 1;
+}
+
+
+inline Value const&
+Aggregate_value::operator[](std::size_t n) const
+{
+  lingo_assert(n < size());
+  return data()[n];
+}
+
+
+// Returns the nth element of the aggregate. The aggregate is
+// detached from any sharing handles.
+inline Value&
+Aggregate_value::operator[](std::size_t n)
+{
+  lingo_assert(n < size());
+  return data()[n];
+}
+
+
+inline Value const*
+Aggregate_value::data() const
+{
+  return rep_ ? rep_->data() : nullptr;
+}
+
+
+// Returns a pointer to the elements of the aggregate. The aggregate
+// is detached from any sharing handles.
+inline Value*
+Aggregate_value::data()
+{
+  if (is_shared())
+    detach();
+  return rep_ ? rep_->data() : nullptr;
+}
+
+
+inline Aggregate_value::const_iterator
+Aggregate_value::begin() const
+{
+  return data();
+}
+
+
+inline Aggregate_value::const_iterator
+Aggregate_value::end() const
+{
+  return data() + size();
+}
+
+
+inline Aggregate_value::iterator
+Aggregate_value::begin()
+{
+  return data();
+}
+
+
+inline Aggregate_value::iterator
+Aggregate_value::end()
+{
+  return data() + size();
+}
+
 
 // -------------------------------------------------------------------------- //
 // Generic visitors
@@ -548,6 +875,7 @@ struct Generic_value_visitor : Value::Visitor, lingo::Generic_visitor<F, T>
   void visit(Error_value const& v)     { this->invoke(v); };
   void visit(Void_value const& v)      { this->invoke(v); };
   void visit(Integer_value const& v)   { this->invoke(v); };
+  void visit(Wide_value const& v)      { this->invoke(v); };
   void visit(Float_value const& v)     { this->invoke(v); };
   void visit(Aggregate_value const& v) { this->invoke(v); };
   void visit(Reference_value const& v) { this->invoke(v); };
@@ -564,6 +892,7 @@ struct Generic_value_mutator : Value::Mutator, lingo::Generic_mutator<F, T>
   void visit(Error_value& v)     { this->invoke(v); };
   void visit(Void_value& v)      { this->invoke(v); };
   void visit(Integer_value& v)   { this->invoke(v); };
+  void visit(Wide_value& v)      { this->invoke(v); };
   void visit(Float_value& v)     { this->invoke(v); };
   void visit(Aggregate_value& v) { this->invoke(v); };
   void visit(Reference_value& v) { this->invoke(v); };
@@ -588,6 +917,38 @@ apply(Value& v, F fn)
 }
 
 
+// -------------------------------------------------------------------------- //
+// Integer arithmetic
+//
+// Integer operations are computed with respect to the precision and
+// signedness of the operation's type. Unsigned arithmetic wraps. Signed
+// arithmetic that overflows, and division by zero, yield an error value.
+//
+// Operations on integer values are computed inline, and are promoted to
+// wide arithmetic only when the type is wider than 64 bits, and either
+// an operand is wide or the inline computation overflows.
+
+
+// Describes the precision and signedness of an integer type.
+struct Integer_spec
+{
+  int  precision;
+  bool is_signed;
+};
+
+
+Value make_integer(Integer_spec, llvm::APSInt const&);
+llvm::APSInt get_wide_integer(Integer_spec, Value const&);
+
+Value integer_add(Integer_spec, Value const&, Value const&);
+Value integer_sub(Integer_spec, Value const&, Value const&);
+Value integer_mul(Integer_spec, Value const&, Value const&);
+Value integer_div(Integer_spec, Value const&, Value const&);
+Value integer_rem(Integer_spec, Value const&, Value const&);
+Value integer_neg(Integer_spec, Value const&);
+int   integer_compare(Integer_spec, Value const&, Value const&);
+
+
 // -------------------------------------------------------------------------- //
 // Intrinsic behaviors
 
@@ -0,0 +1,256 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#include "emitter.hpp"
+
+#include <llvm/IR/Module.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/LTO/Caching.h>
+#include <llvm/LTO/LTO.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/TargetRegistry.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Target/TargetOptions.h>
+#include <llvm/Transforms/IPO.h>
+
+#include <algorithm>
+#include <thread>
+
+
+namespace banjo
+{
+
+namespace ll
+{
+
+// Register the native target with LLVM. This is a process-level
+// configuration, so it only happens once, even when called from
+// multiple threads.
+static void
+init_native_target()
+{
+  static bool init = []() {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+    return true;
+  }();
+  (void)init;
+}
+
+
+// Returns the code generation level for an optimization level.
+static llvm::CodeGenOpt::Level
+get_codegen_level(int level)
+{
+  switch (level) {
+    case 0: return llvm::CodeGenOpt::None;
+    case 1: return llvm::CodeGenOpt::Less;
+    case 2: return llvm::CodeGenOpt::Default;
+    default: return llvm::CodeGenOpt::Aggressive;
+  }
+}
+
+
+// Returns a target machine for the host, or nullptr if code cannot
+// be generated for the host. The level determines how much effort
+// the code generator puts into optimization.
+std::unique_ptr<llvm::TargetMachine>
+make_target_machine(int level)
+{
+  init_native_target();
+
+  std::string triple = llvm::sys::getDefaultTargetTriple();
+  std::string msg;
+  llvm::Target const* target = llvm::TargetRegistry::lookupTarget(triple, msg);
+  if (!target) {
+    lingo::error("cannot generate code for '{}': {}", triple, msg);
+    return nullptr;
+  }
+
+  llvm::TargetOptions opts;
+  llvm::TargetMachine* tm = target->createTargetMachine(
+    triple,                    // target triple
+    "generic",                 // cpu
+    "",                        // features
+    opts,                      // options
+    llvm::Reloc::PIC_,         // relocation model
+    llvm::CodeModel::Default,  // code model
+    get_codegen_level(level)   // optimization level
+  );
+  return std::unique_ptr<llvm::TargetMachine>(tm);
+}
+
+
+// Set the target triple and data layout of the module so that
+// they agree with the target machine.
+void
+configure_module(llvm::Module& mod, llvm::TargetMachine& tm)
+{
+  mod.setTargetTriple(tm.getTargetTriple().str());
+  mod.setDataLayout(tm.createDataLayout());
+}
+
+
+// Generate native object code for the module.
+static bool
+emit_object(llvm::Module& mod, llvm::raw_pwrite_stream& os, int level)
+{
+  std::unique_ptr<llvm::TargetMachine> tm = make_target_machine(level);
+  if (!tm)
+    return false;
+  configure_module(mod, *tm);
+
+  llvm::legacy::PassManager pm;
+  auto kind = llvm::TargetMachine::CGFT_ObjectFile;
+  if (tm->addPassesToEmitFile(pm, os, kind)) {
+    lingo::error("cannot emit object code for '{}'", mod.getTargetTriple());
+    return false;
+  }
+  pm.run(mod);
+  return true;
+}
+
+
+// Returns the output path of the nth of several outputs. The number 
+// is inserted before the extension of path (e.g., a.o becomes a.1.o).
+// Output to stdout is not renamed.
+String
+get_shard_path(String const& path, int n)
+{
+  if (path == "-")
+    return path;
+  String num = std::to_string(n);
+  std::size_t dot = path.rfind('.');
+  std::size_t sep = path.rfind('/');
+  if (dot == String::npos || (sep != String::npos && dot < sep))
+    return path + '.' + num;
+  return path.substr(0, dot) + '.' + num + path.substr(dot);
+}
+
+
+// Write the module as bitcode with a ThinLTO summary. Summaries are
+// used by thin_link() to import definitions across modules.
+static bool
+emit_thin_bitcode(llvm::Module& mod, llvm::raw_ostream& os)
+{
+  llvm::legacy::PassManager pm;
+  pm.add(llvm::createWriteThinLTOBitcodePass(os));
+  pm.run(mod);
+  return true;
+}
+
+
+// Write the module to the file at path. If path is "-", the output 
+// is written to stdout. The level is the optimization level used
+// when generating object code. Returns false if the output could 
+// not be written.
+bool
+emit(llvm::Module& mod, Output_kind kind, String const& path, int level)
+{
+  std::error_code err;
+  auto flags = kind == ir_output ? llvm::sys::fs::F_Text : llvm::sys::fs::F_None;
+  llvm::raw_fd_ostream os(path, err, flags);
+  if (err) {
+    lingo::error("cannot open '{}': {}", path, err.message());
+    return false;
+  }
+
+  switch (kind) {
+    case ir_output:
+      os << mod;
+      return true;
+    case bitcode_output:
+      llvm::WriteBitcodeToFile(&mod, os);
+      return true;
+    case object_output:
+      return emit_object(mod, os, level);
+    case thin_output:
+      return emit_thin_bitcode(mod, os);
+  }
+  lingo_unreachable();
+}
+
+
+// -------------------------------------------------------------------------- //
+// ThinLTO linking
+
+// Link the ThinLTO bitcode files in inputs. Each module imports the
+// definitions it needs from other modules (e.g., for inlining), and 
+// is then optimized and compiled in parallel, producing one object
+// file per module. The objects are named after output, with the 
+// number of each backend task inserted before the extension. All
+// definitions remain visible to the native linker.
+bool
+thin_link(std::vector<String> const& inputs, String const& output, int level)
+{
+  init_native_target();
+
+  llvm::lto::Config conf;
+  conf.CPU = "generic";
+  conf.RelocModel = llvm::Reloc::PIC_;
+  conf.OptLevel = level;
+  conf.CGOptLevel = get_codegen_level(level);
+
+  unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+  llvm::lto::LTO lto(std::move(conf), llvm::lto::createInProcessThinBackend(jobs));
+
+  // The memory buffers must outlive the link.
+  std::vector<std::unique_ptr<llvm::MemoryBuffer>> bufs;
+  for (String const& path : inputs) {
+    auto buf = llvm::MemoryBuffer::getFile(path);
+    if (!buf) {
+      lingo::error("cannot open '{}': {}", path, buf.getError().message());
+      return false;
+    }
+    auto in = llvm::lto::InputFile::create((*buf)->getMemBufferRef());
+    if (!in) {
+      lingo::error("invalid bitcode file '{}': {}", path, llvm::toString(in.takeError()));
+      return false;
+    }
+
+    // Every definition prevails, and is visible outside of the LTO 
+    // unit since the objects are linked by the native linker.
+    std::vector<llvm::lto::SymbolResolution> res;
+    for (llvm::lto::InputFile::Symbol const& sym : (*in)->symbols()) {
+      llvm::lto::SymbolResolution r;
+      r.Prevailing = !sym.isUndefined();
+      r.VisibleToRegularObj = true;
+      res.push_back(r);
+    }
+    if (llvm::Error err = lto.add(std::move(*in), res)) {
+      lingo::error("cannot link '{}': {}", path, llvm::toString(std::move(err)));
+      return false;
+    }
+    bufs.push_back(std::move(*buf));
+  }
+
+  // Each backend task writes its own object file.
+  bool ok = true;
+  auto add_stream = [&](std::size_t task) -> std::unique_ptr<llvm::lto::NativeObjectStream> {
+    String path = get_shard_path(output, task);
+    std::error_code err;
+    std::unique_ptr<llvm::raw_fd_ostream> os(
+      new llvm::raw_fd_ostream(path, err, llvm::sys::fs::F_None));
+    if (err) {
+      lingo::error("cannot open '{}': {}", path, err.message());
+      ok = false;
+    }
+    return std::unique_ptr<llvm::lto::NativeObjectStream>(
+      new llvm::lto::NativeObjectStream(std::move(os)));
+  };
+  if (llvm::Error err = lto.run(add_stream)) {
+    lingo::error("link failed: {}", llvm::toString(std::move(err)));
+    return false;
+  }
+  return ok;
+}
+
+
+} // namespace ll
+
+} // namespace banjo
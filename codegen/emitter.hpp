@@ -0,0 +1,57 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#ifndef BANJO_EMITTER_HPP
+#define BANJO_EMITTER_HPP
+
+// Facilities for writing generated modules to files. Object code is
+// generated in-process by an LLVM target machine for the host.
+
+#include <banjo/prelude.hpp>
+
+#include <memory>
+#include <vector>
+
+
+namespace llvm
+{
+
+class Module;
+class TargetMachine;
+
+} // namespace llvm
+
+
+namespace banjo
+{
+
+namespace ll
+{
+
+// The kinds of files that can be written for a module.
+enum Output_kind
+{
+  ir_output,      // Textual LLVM IR (.ll)
+  bitcode_output, // LLVM bitcode (.bc)
+  object_output,  // Native object code (.o)
+  thin_output,    // LLVM bitcode with a ThinLTO summary (.bc)
+};
+
+
+std::unique_ptr<llvm::TargetMachine> make_target_machine(int = 0);
+
+void configure_module(llvm::Module&, llvm::TargetMachine&);
+
+String get_shard_path(String const&, int);
+
+bool emit(llvm::Module&, Output_kind, String const&, int = 0);
+
+bool thin_link(std::vector<String> const&, String const&, int = 0);
+
+
+} // namespace ll
+
+} // namespace banjo
+
+
+#endif
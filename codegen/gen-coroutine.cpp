@@ -0,0 +1,177 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+
+namespace banjo
+{
+
+namespace ll
+{
+
+// -------------------------------------------------------------------------- //
+// Coroutines
+//
+// A function whose body contains a yield statement is a coroutine. It 
+// is lowered to LLVM's switched-resume coroutine intrinsics, and split
+// into its ramp, resume, and destroy functions by the coroutine passes
+// (see optimize()). 
+//
+// The ramp function allocates the coroutine frame, suspends immediately,
+// and returns the coroutine handle. Each resumption runs the body until
+// the next yield, which stores the yielded value in the promise and
+// suspends. Reaching the end of the body performs a final suspension.
+// Callers access the yielded value through llvm.coro.promise.
+
+
+// Returns true if the statement contains a yield statement.
+static bool
+has_yield(Stmt const& s)
+{
+  struct fn
+  {
+    bool operator()(Stmt const& s)             { return false; }
+    bool operator()(Yield_stmt const& s)       { return true; }
+    bool operator()(Yield_value_stmt const& s) { return true; }
+    bool operator()(If_then_stmt const& s)     { return has_yield(s.true_branch()); }
+    bool operator()(While_stmt const& s)       { return has_yield(s.body()); }
+
+    bool operator()(If_else_stmt const& s) 
+    { 
+      return has_yield(s.true_branch()) || has_yield(s.false_branch()); 
+    }
+
+    bool operator()(Compound_stmt const& s) 
+    {
+      for (Stmt const& s1 : s.statements())
+        if (has_yield(s1))
+          return true;
+      return false;
+    }
+  };
+  return apply(s, fn{});
+}
+
+
+// Returns true if the function is a coroutine.
+bool
+Generator::is_coroutine(Function_decl const& d)
+{
+  if (Function_def const* def = as<Function_def>(&d.definition()))
+    return has_yield(def->statement());
+  return false;
+}
+
+
+// Returns the declaration of a coroutine intrinsic.
+static inline llvm::Function*
+get_intrinsic(llvm::Module* mod, llvm::Intrinsic::ID id, llvm::ArrayRef<llvm::Type*> ts = {})
+{
+  return llvm::Intrinsic::getDeclaration(mod, id, ts);
+}
+
+
+// Build the coroutine prologue in the current block. This allocates
+// the frame (unless the allocation is elided), builds the promise, 
+// which holds values of type t, and performs the initial suspension.
+void
+Generator::gen_coroutine_begin(llvm::Type* t)
+{
+  llvm::PointerType* ptr = build.getInt8PtrTy();
+  llvm::Value* null = llvm::ConstantPointerNull::get(ptr);
+
+  // Build storage for yielded values.
+  llvm::Value* p = null;
+  promise = nullptr;
+  if (!t->isVoidTy()) {
+    promise = build.CreateAlloca(t, nullptr, "promise");
+    p = build.CreateBitCast(promise, ptr);
+  }
+  llvm::Value* align = build.getInt32(0);
+  coro = build.CreateCall(get_intrinsic(mod, llvm::Intrinsic::coro_id), {align, p, null, null});
+
+  // Allocate the frame only if needed.
+  llvm::BasicBlock* head = build.GetInsertBlock();
+  llvm::BasicBlock* alloc = llvm::BasicBlock::Create(cxt, "coro.alloc", fn);
+  llvm::BasicBlock* begin = llvm::BasicBlock::Create(cxt, "coro.begin", fn);
+  llvm::Value* need = build.CreateCall(get_intrinsic(mod, llvm::Intrinsic::coro_alloc), {coro});
+  build.CreateCondBr(need, alloc, begin);
+
+  build.SetInsertPoint(alloc);
+  llvm::Type* size_type = build.getInt64Ty();
+  llvm::Value* size = build.CreateCall(get_intrinsic(mod, llvm::Intrinsic::coro_size, size_type));
+  llvm::Constant* malloc = mod->getOrInsertFunction(
+    "malloc", llvm::FunctionType::get(ptr, size_type, false));
+  llvm::Value* mem = build.CreateCall(malloc, size);
+  build.CreateBr(begin);
+
+  build.SetInsertPoint(begin);
+  llvm::PHINode* frame = build.CreatePHI(ptr, 2);
+  frame->addIncoming(null, head);
+  frame->addIncoming(mem, alloc);
+  handle = build.CreateCall(get_intrinsic(mod, llvm::Intrinsic::coro_begin), {coro, frame});
+
+  // These are inserted into the function by gen_coroutine_end().
+  leave = llvm::BasicBlock::Create(cxt, "coro.suspend");
+  cleanup = llvm::BasicBlock::Create(cxt, "coro.cleanup");
+
+  // The body runs when the coroutine is first resumed.
+  gen_coroutine_suspend(false);
+}
+
+
+// Suspend the coroutine. When resumed, execution continues in a new
+// block. When destroyed, control transfers to the cleanup block. A
+// final suspension cannot be resumed.
+void
+Generator::gen_coroutine_suspend(bool final)
+{
+  llvm::Value* none = llvm::ConstantTokenNone::get(cxt);
+  llvm::Value* s = build.CreateCall(
+    get_intrinsic(mod, llvm::Intrinsic::coro_suspend), {none, build.getInt1(final)});
+
+  llvm::BasicBlock* resume = llvm::BasicBlock::Create(cxt, "coro.resume", fn);
+  llvm::SwitchInst* sw = build.CreateSwitch(s, leave, 2);
+  sw->addCase(build.getInt8(0), resume);
+  sw->addCase(build.getInt8(1), cleanup);
+  build.SetInsertPoint(resume);
+
+  if (final) {
+    build.CreateCall(get_intrinsic(mod, llvm::Intrinsic::trap));
+    build.CreateUnreachable();
+  }
+}
+
+
+// Build the coroutine epilogue at the current insertion point, which
+// is the exit block of the function. 
+void
+Generator::gen_coroutine_end()
+{
+  gen_coroutine_suspend(true);
+
+  // Free the frame. Note that coro.free returns null if the allocation
+  // was elided.
+  fn->getBasicBlockList().push_back(cleanup);
+  build.SetInsertPoint(cleanup);
+  llvm::PointerType* ptr = build.getInt8PtrTy();
+  llvm::Value* mem = build.CreateCall(get_intrinsic(mod, llvm::Intrinsic::coro_free), {coro, handle});
+  llvm::Constant* free = mod->getOrInsertFunction(
+    "free", llvm::FunctionType::get(build.getVoidTy(), ptr, false));
+  build.CreateCall(free, mem);
+  build.CreateBr(leave);
+
+  // Returning from the ramp function (or a resumption) yields the 
+  // handle to the caller.
+  fn->getBasicBlockList().push_back(leave);
+  build.SetInsertPoint(leave);
+  build.CreateCall(get_intrinsic(mod, llvm::Intrinsic::coro_end), {handle, build.getFalse()});
+  build.CreateRet(handle);
+
+  coro = handle = promise = nullptr;
+  leave = cleanup = nullptr;
+}
+
+
+} // namespace ll
+
+} // namespace banjo
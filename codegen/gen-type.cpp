@@ -12,11 +12,34 @@ namespace ll
 // Mapping of types
 //
 // The type generator transforms a beaker type into its corresponding
-// LLVM type.
+// LLVM type. Lowered types are cached so that repeated occurrences of
+// the same type (including the evaluation of array extents) are only
+// computed once.
 
 
 llvm::Type*
 Generator::gen_type(Type const& t)
+{
+  auto iter = lowered.find(&t);
+  if (iter != lowered.end())
+    return iter->second;
+
+  // Look for an equivalent type that has already been lowered.
+  llvm::Type* r;
+  auto iter2 = unique.find(&t);
+  if (iter2 != unique.end()) {
+    r = iter2->second;
+  } else {
+    r = lower_type(t);
+    unique.emplace(&t, r);
+  }
+  lowered.emplace(&t, r);
+  return r;
+}
+
+
+llvm::Type*
+Generator::lower_type(Type const& t)
 {
   struct fn
   {
@@ -53,11 +76,12 @@ Generator::gen_type(Boolean_type const&)
 }
 
 
-// FIXME: This isn't realistic.
+// Return an integer type with the precision of t. Note that LLVM
+// integer types are signless.
 llvm::Type*
 Generator::gen_type(Integer_type const& t)
 {
-  return build.getInt32Ty();
+  return build.getIntNTy(t.precision());
 }
 
 llvm::Type*
@@ -67,11 +91,18 @@ Generator::gen_type(Byte_type const& t)
 }
 
 
-// FIXME: This isn't realistic.
+// Return the IEEE floating point type with the precision of t.
 llvm::Type*
-Generator::gen_type(Float_type const&)
+Generator::gen_type(Float_type const& t)
 {
-  return build.getDoubleTy();
+  switch (t.precision()) {
+    case 16: return build.getHalfTy();
+    case 32: return build.getFloatTy();
+    case 64: return build.getDoubleTy();
+    case 128: return llvm::Type::getFP128Ty(cxt);
+    default: break;
+  }
+  lingo_unhandled(t);
 }
 
 
@@ -96,6 +127,7 @@ llvm::Type*
 Generator::gen_type(Array_type const& t) 
 {
   llvm::Type* t1 = gen_type(t.element_type());
+  std::lock_guard<std::mutex> lock(evaluation_lock());
   Value v = evaluate(banjo, t.extent());
   return llvm::ArrayType::get(t1, v.get_integer());
 }
@@ -2,23 +2,29 @@
 // All rights reserved
 
 #include "generator.hpp"
+#include "emitter.hpp"
 
 #include <banjo/ast.hpp>
 #include <banjo/evaluation.hpp>
 #include <banjo/debugging.hpp>
 
+#include <llvm/Config/llvm-config.h>
 #include <llvm/IR/Type.h>
 #include <llvm/IR/GlobalVariable.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/Constants.h>
+#include <llvm/IR/DataLayout.h>
 #include <llvm/IR/Instructions.h>
+#include <llvm/IR/Intrinsics.h>
+#include <llvm/IR/Metadata.h>
 #include <llvm/IR/Module.h>
-#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Transforms/Utils/ModuleUtils.h>
 
+#include <algorithm>
+#include <iomanip>
 #include <iostream>
 
-#include <unistd.h>
-
 
 namespace banjo
 {
@@ -26,6 +32,14 @@ namespace banjo
 namespace ll
 {
 
+std::mutex&
+evaluation_lock()
+{
+  static std::mutex m;
+  return m;
+}
+
+
 // -------------------------------------------------------------------------- //
 // Generation of names
 
@@ -73,6 +87,7 @@ Generator::gen(Expr const& e)
     llvm::Value* operator()(Not_expr const& e)     { return g.gen(e); }
     llvm::Value* operator()(Tuple_expr const& e)   { return g.gen(e); }
     llvm::Value* operator()(Decl_ref const& e)     { return g.gen(e); }
+    llvm::Value* operator()(Member_ref const& e)   { return g.gen(e); }
 
     llvm::Value* operator()(Value_conv const& e)   { return g.gen(e); }
     llvm::Value* operator()(Boolean_conv const& e) { return g.gen(e); }
@@ -84,7 +99,6 @@ Generator::gen(Expr const& e)
 
     // llvm::Value* operator()(Call_expr const* e) const { return g.gen(e); }
     // llvm::Value* operator()(Dot_expr const* e) const { return g.gen(e); }
-    // llvm::Value* operator()(Field_expr const* e) const { return g.gen(e); }
     // llvm::Value* operator()(Method_expr const* e) const { return g.gen(e); }
     // llvm::Value* operator()(Index_expr const* e) const { return g.gen(e); }
     // llvm::Value* operator()(Promote_conv const* e) const { return g.gen(e); }
@@ -102,11 +116,12 @@ Generator::gen(Boolean_expr const& e)
 }
 
 
-// TODO: Respect the precision of the integer type.
+// The literal is generated in the precision of its type.
 llvm::Value*
 Generator::gen(Integer_expr const& e)
 {
-  return build.getInt(e.value().impl());
+  Value v = make_integer(get_integer_spec(e.type()), e.value().impl());
+  return gen_constant(e.type(), v);
 }
 
 // Build a tuple value.
@@ -174,6 +189,27 @@ Generator::gen(Decl_ref const& e)
   return ret;
 }
 
+
+// Return the address of the member object. Fields are laid out in
+// declaration order.
+llvm::Value*
+Generator::gen(Member_ref const& e)
+{
+  llvm::Value* obj = gen(e.object());
+  Class_decl const& c = cast<Class_type>(e.object().type()).declaration();
+  Decl_list const& objs = c.objects();
+  auto iter = std::find_if(objs.begin(), objs.end(), [&](Decl const& d) {
+    return &d == &e.declaration();
+  });
+  lingo_assert(iter != objs.end());
+  int n = std::distance(objs.begin(), iter);
+  llvm::Value* args[] = {
+    build.getInt32(0),
+    build.getInt32(n)
+  };
+  return build.CreateInBoundsGEP(obj, args);
+}
+
 #if 0
 
 llvm::Value*
@@ -198,11 +234,36 @@ Generator::gen(Decl_expr const* e)
   return result;
 }
 #endif
+
+
+// -------------------------------------------------------------------------- //
+// Generation of arithmetic expressions
+//
+// Arithmetic is performed in the precision of the expression's type,
+// which is also the type of its operands. Signed integer arithmetic
+// cannot overflow (as in constant evaluation), so it is generated with
+// the nsw flag. Unsigned integer arithmetic wraps.
+
+
+// Returns true if the type is a signed integer type.
+static inline bool
+is_signed_integer(Type const& t)
+{
+  if (Integer_type const* i = as<Integer_type>(&t))
+    return i->is_signed();
+  return false;
+}
+
+
 llvm::Value*
 Generator::gen(Add_expr const& e)
 {
   llvm::Value* l = gen(e.left());
   llvm::Value* r = gen(e.right());
+  if (is_floating_point_type(e.type()))
+    return build.CreateFAdd(l, r);
+  if (is_signed_integer(e.type()))
+    return build.CreateNSWAdd(l, r);
   return build.CreateAdd(l, r);
 }
 
@@ -212,6 +273,10 @@ Generator::gen(Sub_expr const& e)
 {
   llvm::Value* l = gen(e.left());
   llvm::Value* r = gen(e.right());
+  if (is_floating_point_type(e.type()))
+    return build.CreateFSub(l, r);
+  if (is_signed_integer(e.type()))
+    return build.CreateNSWSub(l, r);
   return build.CreateSub(l, r);
 }
 
@@ -221,6 +286,10 @@ Generator::gen(Mul_expr const& e)
 {
   llvm::Value* l = gen(e.left());
   llvm::Value* r = gen(e.right());
+  if (is_floating_point_type(e.type()))
+    return build.CreateFMul(l, r);
+  if (is_signed_integer(e.type()))
+    return build.CreateNSWMul(l, r);
   return build.CreateMul(l, r);
 }
 
@@ -230,17 +299,23 @@ Generator::gen(Div_expr const& e)
 {
   llvm::Value* l = gen(e.left());
   llvm::Value* r = gen(e.right());
-  return build.CreateSDiv(l, r);
+  if (is_floating_point_type(e.type()))
+    return build.CreateFDiv(l, r);
+  if (is_signed_integer(e.type()))
+    return build.CreateSDiv(l, r);
+  return build.CreateUDiv(l, r);
 }
 
 
-// FIXME: decide on unsigned or signed remainder
-// based on types of expressions
 llvm::Value*
 Generator::gen(Rem_expr const& e)
 {
   llvm::Value* l = gen(e.left());
   llvm::Value* r = gen(e.right());
+  if (is_floating_point_type(e.type()))
+    return build.CreateFRem(l, r);
+  if (is_signed_integer(e.type()))
+    return build.CreateSRem(l, r);
   return build.CreateURem(l, r);
 }
 
@@ -248,9 +323,12 @@ Generator::gen(Rem_expr const& e)
 llvm::Value*
 Generator::gen(Neg_expr const& e)
 {
-  llvm::Value* zero = build.getInt32(0);
   llvm::Value* val = gen(e.operand());
-  return build.CreateSub(zero, val);
+  if (is_floating_point_type(e.type()))
+    return build.CreateFNeg(val);
+  if (is_signed_integer(e.type()))
+    return build.CreateNSWNeg(val);
+  return build.CreateNeg(val);
 }
 
 
@@ -261,12 +339,40 @@ Generator::gen(Pos_expr const& e)
 }
 
 
+// -------------------------------------------------------------------------- //
+// Generation of relational expressions
+//
+// Operands are compared according to the type of the left operand. 
+// Floating point comparisons are ordered, except for inequality, 
+// which is true when either operand is NaN.
+
+// Generate a comparison of l and r using the integer predicate for
+// signed or unsigned operands, or the floating point predicate.
+llvm::Value*
+Generator::gen_compare(Type const& t, 
+                       llvm::Value* l, 
+                       llvm::Value* r, 
+                       llvm::CmpInst::Predicate s, 
+                       llvm::CmpInst::Predicate u, 
+                       llvm::CmpInst::Predicate f)
+{
+  if (is_floating_point_type(t))
+    return build.CreateFCmp(f, l, r);
+  if (is_signed_integer(t))
+    return build.CreateICmp(s, l, r);
+  return build.CreateICmp(u, l, r);
+}
+
+
 llvm::Value*
 Generator::gen(Eq_expr const& e)
 {
   llvm::Value* l = gen(e.left());
   llvm::Value* r = gen(e.right());
-  return build.CreateICmpEQ(l, r);
+  return gen_compare(e.left().type(), l, r, 
+                     llvm::CmpInst::ICMP_EQ, 
+                     llvm::CmpInst::ICMP_EQ, 
+                     llvm::CmpInst::FCMP_OEQ);
 }
 
 
@@ -275,7 +381,10 @@ Generator::gen(Ne_expr const& e)
 {
   llvm::Value* l = gen(e.left());
   llvm::Value* r = gen(e.right());
-  return build.CreateICmpNE(l, r);
+  return gen_compare(e.left().type(), l, r, 
+                     llvm::CmpInst::ICMP_NE, 
+                     llvm::CmpInst::ICMP_NE, 
+                     llvm::CmpInst::FCMP_UNE);
 }
 
 
@@ -284,7 +393,10 @@ Generator::gen(Lt_expr const& e)
 {
   llvm::Value* l = gen(e.left());
   llvm::Value* r = gen(e.right());
-  return build.CreateICmpSLT(l, r);
+  return gen_compare(e.left().type(), l, r, 
+                     llvm::CmpInst::ICMP_SLT, 
+                     llvm::CmpInst::ICMP_ULT, 
+                     llvm::CmpInst::FCMP_OLT);
 }
 
 
@@ -293,7 +405,10 @@ Generator::gen(Gt_expr const& e)
 {
   llvm::Value* l = gen(e.left());
   llvm::Value* r = gen(e.right());
-  return build.CreateICmpSGT(l, r);
+  return gen_compare(e.left().type(), l, r, 
+                     llvm::CmpInst::ICMP_SGT, 
+                     llvm::CmpInst::ICMP_UGT, 
+                     llvm::CmpInst::FCMP_OGT);
 }
 
 
@@ -302,7 +417,10 @@ Generator::gen(Le_expr const& e)
 {
   llvm::Value* l = gen(e.left());
   llvm::Value* r = gen(e.right());
-  return build.CreateICmpSLE(l, r);
+  return gen_compare(e.left().type(), l, r, 
+                     llvm::CmpInst::ICMP_SLE, 
+                     llvm::CmpInst::ICMP_ULE, 
+                     llvm::CmpInst::FCMP_OLE);
 }
 
 
@@ -311,7 +429,10 @@ Generator::gen(Ge_expr const& e)
 {
   llvm::Value* l = gen(e.left());
   llvm::Value* r = gen(e.right());
-  return build.CreateICmpSGE(l, r);
+  return gen_compare(e.left().type(), l, r, 
+                     llvm::CmpInst::ICMP_SGE, 
+                     llvm::CmpInst::ICMP_UGE, 
+                     llvm::CmpInst::FCMP_OGE);
 }
 
 
@@ -326,6 +447,8 @@ Generator::gen(Cmp_expr const& e)
 {
   llvm::Value* l = gen(e.left());
   llvm::Value* r = gen(e.right());
+  if (is_floating_point_type(e.left().type()))
+    return build.CreateFSub(l, r);
   return build.CreateSub(l, r);
 }
 
@@ -407,22 +530,23 @@ Generator::gen(Value_conv const& e)
 }
 
 
-// Convert to a boolean value. Behavior depends on the source type.
-//
-//    - integer type: the source is truncated to i1
-//    - floating point type: the result is fp-converted to i1.
+// Convert to a boolean value. The result is true when the source
+// value is non-zero, regardless of its precision. For floating point
+// types, NaN converts to true.
 //
 // Note that the source will never have boolean type.
 llvm::Value*
 Generator::gen(Boolean_conv const& e)
 {
   llvm::Value* src = gen(e.source());
-  llvm::Type* dst = build.getInt1Ty();
+  llvm::Value* zero = llvm::Constant::getNullValue(src->getType());
 
   // Build the corresponding conversion.
   Type const& t = e.source().type();
   if (is_integer_type(t))
-    return build.CreateTrunc(src, dst);
+    return build.CreateICmpNE(src, zero);
+  if (is_floating_point_type(t))
+    return build.CreateFCmpUNE(src, zero);
 
   lingo_unhandled(t);
 }
@@ -505,23 +629,6 @@ Generator::gen(Dot_expr const* e)
 }
 
 
-llvm::Value*
-Generator::gen(Field_expr const* e)
-{
-  llvm::Value* obj = gen(e->container());
-
-  // Build the GEP index array.
-  Field_path const& p = e->path();
-  std::vector<llvm::Value*> args(p.size() + 1);
-  args[0] = build.getInt32(0);
-  std::transform(p.begin(), p.end(), ++args.begin(), [&](int n) {
-    return build.getInt32(n);
-  });
-
-  return build.CreateGEP(obj, args);
-}
-
-
 // Just generate the base object. This will be used
 // as the argument for the method call.
 llvm::Value*
@@ -540,7 +647,7 @@ Generator::gen(Index_expr const* e)
     build.getInt32(0), // 0th element from base
     ix                 // requested index
   };
-  return build.CreateGEP(arr, args);
+  return build.CreateInBoundsGEP(arr, args);
 }
 
 
@@ -596,7 +703,7 @@ Generator::gen(Base_conv const* e)
 {
   llvm::Value* a = gen(e->source());
   std::vector<llvm::Value*> args(e->path().size(), build.getInt32(0));
-  return build.CreateGEP(a, args);
+  return build.CreateInBoundsGEP(a, args);
 }
 
 // TODO: Return the value or store it?
@@ -644,6 +751,7 @@ Generator::gen(Stmt const& s)
     void operator()(Compound_stmt const& s)    { g.gen(s); }
     void operator()(Return_stmt const& s)      { g.gen(s); }
     void operator()(Yield_stmt const& s)       { g.gen(s); }
+    void operator()(Yield_value_stmt const& s) { g.gen(s); }
     void operator()(If_then_stmt const& s)     { g.gen(s); }
     void operator()(If_else_stmt const& s)     { g.gen(s); }
     void operator()(While_stmt const& s)       { g.gen(s); }
@@ -701,17 +809,17 @@ Generator::gen(Return_value_stmt const& s)
 void
 Generator::gen(Yield_stmt const& s)
 {
-  lingo_unreachable();
-  // build.CreateBr(exit);
+  gen_coroutine_suspend(false);
 }
 
 
+// Store the yielded value in the coroutine's promise and suspend.
 void
 Generator::gen(Yield_value_stmt const& s)
 {
   llvm::Value* v = gen(s.expression());
-  build.CreateStore(v, ret);
-  build.CreateBr(leave);
+  build.CreateStore(v, promise);
+  gen_coroutine_suspend(false);
 }
 
 
@@ -787,14 +895,47 @@ Generator::gen(While_stmt const& s)
   build.SetInsertPoint(body);
   gen(s.body());
   body = build.GetInsertBlock();
-  if (!body->getTerminator())
-    build.CreateBr(top);
+  if (!body->getTerminator()) {
+    llvm::BranchInst* latch = build.CreateBr(top);
+    latch->setMetadata(llvm::LLVMContext::MD_loop, gen_loop_id(s.hints()));
+  }
 
   // Emit the bottom block.
   build.SetInsertPoint(bot);
 }
 
 
+// Returns a new loop identifier for the back edge of a loop. The
+// identifier is a distinct, self-referential node whose remaining
+// operands carry the hints given in the source. Every loop gets an
+// identifier so that later passes can attach their own properties.
+llvm::MDNode*
+Generator::gen_loop_id(Loop_hints const& h)
+{
+  auto prop = [this](char const* name, llvm::Constant* c) -> llvm::Metadata* {
+    llvm::Metadata* ops[] {
+      llvm::MDString::get(cxt, name),
+      llvm::ConstantAsMetadata::get(c)
+    };
+    return llvm::MDNode::get(cxt, ops);
+  };
+
+  // Reserve the first operand for the self-reference.
+  llvm::TempMDTuple self = llvm::MDNode::getTemporary(cxt, llvm::None);
+  std::vector<llvm::Metadata*> ops { self.get() };
+  if (h.vectorize) {
+    ops.push_back(prop("llvm.loop.vectorize.enable", build.getTrue()));
+    ops.push_back(prop("llvm.loop.vectorize.width", build.getInt32(h.vectorize)));
+  }
+  if (h.unroll)
+    ops.push_back(prop("llvm.loop.unroll.count", build.getInt32(h.unroll)));
+
+  llvm::MDNode* id = llvm::MDNode::get(cxt, ops);
+  id->replaceOperandWith(0, id);
+  return id;
+}
+
+
 // Branch to the bottom of the current loop.
 void
 Generator::gen(Break_stmt const& s)
@@ -871,14 +1012,24 @@ Generator::gen(Translation_unit const& s)
   lingo_assert(!mod);
   mod = new llvm::Module("a.ll", cxt);
 
+  // Class layouts depend on the alignment of fields, so make sure
+  // that they are computed for the target.
+  Layout_options const& opts = banjo.layout_options();
+  if (opts.stats) {
+    if (std::unique_ptr<llvm::TargetMachine> tm = make_target_machine())
+      configure_module(*mod, *tm);
+  }
+
+  // Imported declarations are external. They are declared before
+  // the statements that use them.
+  for (Decl const& d : banjo.imported_declarations())
+    gen(d);
+
   gen(s.statements());
+  gen_dynamic_init();
 
-  // Dump the code to stdout.
-  //
-  // FIXME: This is stupid. Actually dump it to a specified output file.
-  std::error_code err;
-  llvm::raw_fd_ostream ofs(STDOUT_FILENO, false);
-  ofs << *mod;
+  if (opts.stats && shard == 0)
+    print_layouts(std::cerr);
 }
 
 
@@ -915,13 +1066,24 @@ Generator::gen_global_variable(Variable_decl const& d)
   String      name = get_name(d);
   llvm::Type* type = gen_type(d.type());
 
-  // Generate a null constant initializer for the global. Note that this 
-  // might be overritten by a static initializer later.
-  //
-  // TODO: Check the variable definition. If it's non-constant, then
-  // add it to a static initialization queue for later.
-  llvm::Constant* init = llvm::Constant::getNullValue(type);
+  // Only the first shard defines global variables. Other shards
+  // simply declare them, as do the importers of a variable.
+  if (shard != 0 || d.specifiers() & extern_spec) {
+    llvm::GlobalVariable* var = new llvm::GlobalVariable(
+      *mod, type, false, llvm::GlobalVariable::ExternalLinkage, nullptr, name);
+    stack.top().bind(&d, var);
+    return;
+  }
 
+  // If the variable has a constant initializer, then its value is the
+  // global's initializer. Otherwise, generate a null constant for the
+  // global, and initialize it dynamically before main.
+  llvm::Constant* init = gen_static_init(d);
+  if (!init) {
+    init = llvm::Constant::getNullValue(type);
+    if (is<Expression_def>(d.initializer()))
+      inits.push_back(&d);
+  }
 
   // Build the global variable, automatically adding
   // it to the module.
@@ -958,6 +1120,68 @@ Generator::gen(Variable_decl const& d)
 // -------------------------------------------------------------------------- //
 // Iniitialization of variables
 
+// Returns the constant initializer of a global variable, or nullptr if 
+// the variable has no initializer or is not initialized by a constant
+// expression. The initializer is computed by the evaluator.
+llvm::Constant*
+Generator::gen_static_init(Variable_decl const& d)
+{
+  Expression_def const* def = as<Expression_def>(&d.initializer());
+  if (!def)
+    return nullptr;
+  Expr const& e = def->expression();
+  if (!is_constant_expression(e))
+    return nullptr;
+
+  // If evaluation fails, leave the initialization to run time.
+  Value v;
+  try {
+    std::lock_guard<std::mutex> lock(evaluation_lock());
+    Suppress_diagnostics diags(banjo);
+    Evaluator eval(banjo);
+    Evaluator::Profile_scope prof(eval, &d);
+    if (is<Copy_init>(&e) || is<Aggregate_init>(&e))
+      eval.initialize(v, e);
+    else
+      v = eval.evaluate(e);
+  } catch (Evaluation_error&) {
+    return nullptr;
+  }
+  return gen_constant(d.type(), v);
+}
+
+
+// Generate a function that initializes all global variables with 
+// non-constant initializers, in order of declaration. The function
+// is registered as a global constructor so that it runs before main.
+void
+Generator::gen_dynamic_init()
+{
+  if (inits.empty())
+    return;
+
+  llvm::FunctionType* type = llvm::FunctionType::get(build.getVoidTy(), false);
+  fn = llvm::Function::Create(
+    type,                            // function type
+    llvm::Function::InternalLinkage, // linkage
+    "__banjo_init",                  // name
+    mod);                            // owning module
+  
+  entry = llvm::BasicBlock::Create(cxt, "entry", fn);
+  build.SetInsertPoint(entry);
+  for (Variable_decl const* d : inits) {
+    Expression_def const& def = cast<Expression_def>(d->initializer());
+    gen_init(lookup(*d), def);
+  }
+  build.CreateRetVoid();
+  llvm::appendToGlobalCtors(*mod, fn, 65535);
+
+  inits.clear();
+  fn = nullptr;
+}
+
+
+
 void
 Generator::gen_local_init(llvm::Value* ptr, Def const& d)
 {
@@ -996,6 +1220,60 @@ Generator::gen_init(llvm::Value* ptr, Expression_def const& e)
 }
 
 
+// -------------------------------------------------------------------------- //
+// Constants
+
+// Returns the constant value of v with type t, or nullptr if the value
+// cannot be represented as a constant.
+llvm::Constant*
+Generator::gen_constant(Type const& t, Value const& v)
+{
+  if (v.is_error())
+    return nullptr;
+
+  if (is_boolean_type(t))
+    return build.getInt1(v.get_integer());
+
+  // Build the integer in the width of its generated type.
+  if (is_integer_type(t)) {
+    llvm::IntegerType* type = llvm::cast<llvm::IntegerType>(gen_type(t));
+    llvm::APSInt n = get_wide_integer(get_integer_spec(t), v);
+    return llvm::ConstantInt::get(cxt, n.extOrTrunc(type->getBitWidth()));
+  }
+
+  if (!v.is_aggregate())
+    return nullptr;
+  Aggregate_value const& a = v.get_aggregate();
+  std::vector<llvm::Constant*> elems;
+  elems.reserve(a.size());
+
+  if (Tuple_type const* tt = as<Tuple_type>(&t)) {
+    Type_list const& ts = tt->element_types();
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      llvm::Constant* c = gen_constant(ts[i], a[i]);
+      if (!c)
+        return nullptr;
+      elems.push_back(c);
+    }
+    llvm::StructType* type = llvm::cast<llvm::StructType>(gen_type(t));
+    return llvm::ConstantStruct::get(type, elems);
+  }
+
+  if (Array_type const* at = as<Array_type>(&t)) {
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      llvm::Constant* c = gen_constant(at->element_type(), a[i]);
+      if (!c)
+        return nullptr;
+      elems.push_back(c);
+    }
+    llvm::ArrayType* type = llvm::cast<llvm::ArrayType>(gen_type(t));
+    return llvm::ConstantArray::get(type, elems);
+  }
+
+  return nullptr;
+}
+
+
 // -------------------------------------------------------------------------- //
 // Function declarations
 
@@ -1004,9 +1282,15 @@ Generator::gen(Function_decl const& d)
 {
   String name = get_name(d);
   llvm::Type* type = gen_type(d.type());
+  llvm::FunctionType* ftype = llvm::cast<llvm::FunctionType>(type);
+
+  // A coroutine returns its handle. Yielded values are accessed
+  // through its promise.
+  bool co = is_coroutine(d);
+  if (co)
+    ftype = llvm::FunctionType::get(build.getInt8PtrTy(), ftype->params(), false);
 
   // Build the function.
-  llvm::FunctionType* ftype = llvm::cast<llvm::FunctionType>(type);
   fn = llvm::Function::Create(
     ftype,                           // function type
     llvm::Function::ExternalLinkage, // linkage
@@ -1016,6 +1300,19 @@ Generator::gen(Function_decl const& d)
   // Create a new binding for the variable.
   declare(d, fn);
 
+  // An imported function is defined in another module.
+  if (d.specifiers() & extern_spec) {
+    fn = nullptr;
+    return;
+  }
+
+  // If the definition belongs to another shard, then this is only
+  // a declaration.
+  if (declcxt == global_cxt && defns++ % shards != shard) {
+    fn = nullptr;
+    return;
+  }
+  Time_scope span(banjo, "generate", d);
 
   // Establish a new environment for declarations within this 
   // function's scope.
@@ -1044,7 +1341,7 @@ Generator::gen(Function_decl const& d)
   build.SetInsertPoint(entry);
 
   // Build storage for the return value if non-void.
-  if (!is<Void_type>(d.return_type()))
+  if (!co && !is<Void_type>(d.return_type()))
     ret = build.CreateAlloca(fn->getReturnType());
   else
     ret = nullptr;
@@ -1071,6 +1368,11 @@ Generator::gen(Function_decl const& d)
       ++pi;
     }
   }
+
+  // Build the coroutine frame after the parameters have been copied, 
+  // so that they are saved in the frame.
+  if (co)
+    gen_coroutine_begin(gen_type(d.return_type()));
   
   // Generate the body.
   gen_function_definition(d.definition());
@@ -1086,7 +1388,9 @@ Generator::gen(Function_decl const& d)
   build.SetInsertPoint(exit);
 
   // Load and return the returned value.
-  if (ret)
+  if (co)
+    gen_coroutine_end();
+  else if (ret)
     build.CreateRet(build.CreateLoad(ret));
   else
     build.CreateRetVoid();
@@ -1098,6 +1402,10 @@ Generator::gen(Function_decl const& d)
 
 
 
+// Generate the structure type of a class. The structure contains
+// the member objects of the class, base class sub-objects first. If
+// the record is empty, generate a struct with exactly one byte so
+// that we never have a type with 0 size.
 void
 Generator::gen(Class_decl const& d)
 {
@@ -1105,28 +1413,21 @@ Generator::gen(Class_decl const& d)
   if (types.lookup(&d))
     return;
 
-  // Holds the types and also the super classes.
-  // Super classes should be put at the head of the vector
+  // Lower the types of member objects in declaration order.
+  Class_def const& def = cast<Class_def>(d.definition());
   std::vector<llvm::Type*> ts;
-
-  // Check for parent classes and add them to ts
-  Class_def def = as<Class_def>(d.definition());
-
-  // Construct the type over only the fields. If the record
-  // is empty, generate a struct with exactly one  byte so that
-  // we never have a type with 0 size.
-  if (def.objects().empty()) {
+  for (Decl const& mem : def.objects())
+    ts.push_back(gen_type(cast<Typed_decl>(mem).type()));
+  if (ts.empty())
     ts.push_back(build.getInt8Ty());
-  } 
-  else {
-    for (Decl const& mem : def.objects())
-      ts.push_back(gen_type(cast<Typed_decl>(mem).type()));
-  }
 
   // Create the llvm type
-  llvm::Type* t = llvm::StructType::create(cxt, ts, get_name(d));
+  llvm::StructType* t = llvm::StructType::create(cxt, ts, get_name(d));
   types.bind(&d,t);
 
+  if (banjo.layout_options().stats)
+    record_layout(d, t);
+
   // Now, generate code for all other members.
   // FIXME: Re-enable the emission of methods, and functions for
   //
@@ -1139,6 +1440,46 @@ Generator::gen(Class_decl const& d)
 }
 
 
+// Record the size and padding of the structure t, generated for the
+// class d.
+void
+Generator::record_layout(Class_decl const& d, llvm::StructType* t)
+{
+  llvm::DataLayout const& dl = mod->getDataLayout();
+  Class_layout l;
+  l.decl = &d;
+  l.size = dl.getTypeAllocSize(t);
+  l.align = dl.getABITypeAlignment(t);
+  l.padding = l.size;
+  for (llvm::Type* e : t->elements())
+    l.padding -= dl.getTypeAllocSize(e);
+  layouts.push_back(l);
+}
+
+
+// Print the layout of each class, with the most padded classes first.
+void
+Generator::print_layouts(std::ostream& os)
+{
+  std::vector<Class_layout> ls = layouts;
+  std::stable_sort(ls.begin(), ls.end(), [](Class_layout const& a, Class_layout const& b) {
+    return a.padding > b.padding;
+  });
+
+  os << "-- class layout --\n";
+  os << std::setw(10) << "size"
+     << std::setw(10) << "align"
+     << std::setw(10) << "padding"
+     << "  class\n";
+  for (Class_layout const& l : ls) {
+    os << std::setw(10) << l.size
+       << std::setw(10) << l.align
+       << std::setw(10) << l.padding
+       << "  " << l.decl->name() << '\n';
+  }
+}
+
+
 void 
 Generator::gen_function_definition(Def const& d)
 {
@@ -1362,3 +1703,4 @@ Generator::operator()(Decl const& d)
 
 
 #include "gen-type.cpp"
+#include "gen-coroutine.cpp"
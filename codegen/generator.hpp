@@ -8,12 +8,16 @@
 
 #include <banjo/language.hpp>
 #include <banjo/ast.hpp>
+#include <banjo/hashing.hpp>
+#include <banjo/equivalence.hpp>
 
 #include <lingo/environment.hpp>
 
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/IRBuilder.h>
 
+#include <iosfwd>
+#include <mutex>
 #include <stack>
 
 
@@ -46,15 +50,41 @@ using Symbol_stack = lingo::Stack<Symbol_env>;
 using Type_env = lingo::Environment<Decl const*, llvm::Type*>;
 
 
+// Caches the lowering of Banjo types to LLVM types. The first cache is 
+// keyed on the address of a type, and the second on its structure, so
+// that each distinct type is lowered exactly once per module.
+using Type_cache = std::unordered_map<Type const*, llvm::Type*>;
+using Type_map   = std::unordered_map<Type const*, llvm::Type*, Type_hash, Type_eq>;
+
+
+// The size and padding, in bytes, of the lowered structure of a class.
+struct Class_layout
+{
+  Class_decl const* decl;
+  std::size_t       size;
+  std::size_t       align;
+  std::size_t       padding;
+};
+
+
+// The generator translates a Banjo translation unit into an LLVM
+// module. For parallel code generation, a translation unit can be
+// partitioned into shards, each generated into its own LLVM context
+// and module. Function definitions are assigned to shards round-robin;
+// the first shard also defines all global variables. Every shard
+// declares the entities defined in other shards, and those imported
+// from other translation units.
 struct Generator
 {
   Generator(Context&);
+  Generator(Context&, int, int);
 
   llvm::Module* operator()(Decl const&);
 
   String get_name(Decl const&);
 
   llvm::Type* gen_type(Type const&);
+  llvm::Type* lower_type(Type const&);
   llvm::Type* gen_type(Void_type const&);
   llvm::Type* gen_type(Boolean_type const&);
   llvm::Type* gen_type(Integer_type const&);
@@ -71,6 +101,7 @@ struct Generator
   llvm::Value* gen(Integer_expr const&);
   llvm::Value* gen(Tuple_expr const&);
   llvm::Value* gen(Decl_ref const&);
+  llvm::Value* gen(Member_ref const&);
 
   // Arithmetic expressions
   llvm::Value* gen(Real_expr const&);
@@ -83,6 +114,10 @@ struct Generator
   llvm::Value* gen(Pos_expr const&);
 
   // Relational expressions
+  llvm::Value* gen_compare(Type const&, llvm::Value*, llvm::Value*, 
+                           llvm::CmpInst::Predicate, 
+                           llvm::CmpInst::Predicate, 
+                           llvm::CmpInst::Predicate);
   llvm::Value* gen(Eq_expr const&);
   llvm::Value* gen(Ne_expr const&);
   llvm::Value* gen(Lt_expr const&);
@@ -111,6 +146,7 @@ struct Generator
   void gen(If_then_stmt const&);
   void gen(If_else_stmt const&);
   void gen(While_stmt const&);
+  llvm::MDNode* gen_loop_id(Loop_hints const&);
   void gen(Break_stmt const&);
   void gen(Continue_stmt const&);
   void gen(Expression_stmt const&);
@@ -129,17 +165,30 @@ struct Generator
   void gen_global_variable(Variable_decl const&);
   void gen_local_init(llvm::Value*, Def const&);
   void gen_global_init(llvm::Value*, Def const&);
+  llvm::Constant* gen_static_init(Variable_decl const&);
+  void gen_dynamic_init();
   void gen_init(llvm::Value*, Empty_def const&);
   void gen_init(llvm::Value*, Expression_def const&);
 
+  // Constants
+  llvm::Constant* gen_constant(Type const&, Value const&);
+
   // Function declarations
   void gen(Function_decl const&);
   void gen_function_definition(Def const&);
   void gen_function_definition(Function_def const&);
 
+  // Coroutines
+  bool is_coroutine(Function_decl const&);
+  void gen_coroutine_begin(llvm::Type*);
+  void gen_coroutine_suspend(bool);
+  void gen_coroutine_end();
+
   // Class declarations
   void gen(Type_decl const&);
   void gen(Class_decl const&);
+  void record_layout(Class_decl const&, llvm::StructType*);
+  void print_layouts(std::ostream&);
 
   void gen(Variable_parm const&);
 
@@ -165,16 +214,30 @@ struct Generator
   llvm::BasicBlock* top;   // Loop top
   llvm::BasicBlock* bot;   // Loop bottom
 
-  // Information about coroutines
-  llvm::BasicBlock* leave;   // Coroutine yield
-  llvm::BasicBlock* reenter; // Should be where the corouitine goes.
-  llvm::Type*       first;   // First call
-  std::vector<llvm::BasicBlock*> blocks; // Holds all of the blocks between yield statments
+  // Information about the current coroutine.
+  llvm::Value*      coro;    // The coroutine id
+  llvm::Value*      handle;  // The coroutine handle
+  llvm::Value*      promise; // Storage for yielded values
+  llvm::BasicBlock* leave;   // Coroutine suspension
+  llvm::BasicBlock* cleanup; // Coroutine destruction
+
+  // Global variables requiring dynamic initialization.
+  std::vector<Variable_decl const*> inits;
+
+  // Partitioning for parallel code generation.
+  int shard;  // The shard generated by this generator
+  int shards; // The total number of shards
+  int defns;  // The number of function definitions seen
 
   // Environment.
   int           declcxt; // The current declaration context
   Symbol_stack  stack;   // Local symbol names
   Type_env      types;   // Declared types
+  Type_cache    lowered; // Lowered types, by address
+  Type_map      unique;  // Lowered types, by structure
+
+  // Layouts of generated classes.
+  std::vector<Class_layout> layouts;
 
   struct Enter_context;
   struct Enter_loop;
@@ -183,10 +246,25 @@ struct Generator
 
 inline
 Generator::Generator(Context& bc)
-  : banjo(bc), cxt(), build(cxt), mod(nullptr), declcxt(invalid_cxt)
+  : Generator(bc, 0, 1)
+{ }
+
+
+// Initialize a generator for the nth of k shards.
+inline
+Generator::Generator(Context& bc, int n, int k)
+  : banjo(bc), cxt(), build(cxt), mod(nullptr)
+  , coro(nullptr), handle(nullptr), promise(nullptr)
+  , leave(nullptr), cleanup(nullptr)
+  , shard(n), shards(k), defns(0), declcxt(invalid_cxt)
 { }
 
 
+// The evaluator shares state in the Banjo context. When generating
+// shards in parallel, calls into the evaluator must hold this lock.
+std::mutex& evaluation_lock();
+
+
 inline void 
 Generator::declare(Decl const& d, llvm::Value* v)
 {
@@ -0,0 +1,162 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#include "optimizer.hpp"
+#include "emitter.hpp"
+
+#include <llvm/ADT/Triple.h>
+#include <llvm/Analysis/TargetLibraryInfo.h>
+#include <llvm/Analysis/TargetTransformInfo.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Transforms/IPO.h>
+#include <llvm/Transforms/IPO/PassManagerBuilder.h>
+#include <llvm/Transforms/Instrumentation.h>
+#include <llvm/Transforms/Coroutines.h>
+#include <llvm/Transforms/Scalar.h>
+
+
+namespace banjo
+{
+
+namespace ll
+{
+
+// Instrument the module or annotate it with profile data. This runs
+// before optimization so that the optimizer sees the branch weights
+// derived from the profile. Profiles are collected and applied at the
+// IR level, so they cover every branch the generator creates, 
+// including those of short-circuit logical operators.
+static void
+apply_profile(llvm::Module& mod, Profile_options const& prof)
+{
+  if (prof.generate.empty() && prof.use.empty())
+    return;
+
+  llvm::legacy::PassManager pm;
+  llvm::InstrProfOptions opts;
+  opts.InstrProfileOutput = prof.generate;
+  if (!prof.use.empty())
+    pm.add(llvm::createPGOInstrumentationUseLegacyPass(prof.use));
+  if (!prof.generate.empty()) {
+    pm.add(llvm::createPGOInstrumentationGenLegacyPass());
+    pm.add(llvm::createInstrProfilingLegacyPass(opts));
+  }
+  pm.run(mod);
+}
+
+
+// Returns true if the module contains coroutines. These must be 
+// lowered by the coroutine passes, even when not optimizing.
+static bool
+has_coroutines(llvm::Module& mod)
+{
+  return mod.getFunction("llvm.coro.begin") != nullptr;
+}
+
+
+// Add the passes that split coroutines into their ramp, resume, and
+// destroy functions, and elide their frame allocations when possible.
+// Elision only applies to calls of split coroutines, so it must run
+// after the split, in the module pipeline.
+static void
+add_coroutine_passes(llvm::legacy::PassManager& mpm)
+{
+  mpm.add(llvm::createCoroEarlyPass());
+  mpm.add(llvm::createCoroSplitPass());
+  mpm.add(llvm::createCoroElidePass());
+  mpm.add(llvm::createCoroCleanupPass());
+}
+
+
+// The -O1 pipeline. The generator puts every parameter, local variable
+// and return value in an alloca, so the most important passes are the
+// ones that promote those to registers and clean up after them.
+static void
+add_basic_passes(llvm::legacy::FunctionPassManager& fpm)
+{
+  fpm.add(llvm::createSROAPass());
+  fpm.add(llvm::createEarlyCSEPass());
+  fpm.add(llvm::createInstructionCombiningPass());
+  fpm.add(llvm::createCFGSimplificationPass());
+  fpm.add(llvm::createGVNPass());
+  fpm.add(llvm::createInstructionCombiningPass());
+  fpm.add(llvm::createCFGSimplificationPass());
+}
+
+
+// The -O2 and -O3 pipelines are LLVM's standard pipelines, including 
+// the inliner and vectorizers. For ThinLTO, this is the pre-link
+// pipeline: passes that depend on the definitions imported at link
+// time (e.g., vectorization and late unrolling) are deferred to the
+// link, which runs the rest of the pipeline.
+static void
+add_standard_passes(llvm::legacy::FunctionPassManager& fpm, 
+                    llvm::legacy::PassManager& mpm, 
+                    int level,
+                    bool prelink)
+{
+  llvm::PassManagerBuilder pmb;
+  pmb.OptLevel = level;
+  pmb.SizeLevel = 0;
+  pmb.Inliner = llvm::createFunctionInliningPass(level, 0);
+  pmb.LoopVectorize = true;
+  pmb.SLPVectorize = true;
+  pmb.PrepareForThinLTO = prelink;
+  llvm::addCoroutinePassesToExtensionPoints(pmb);
+  pmb.populateFunctionPassManager(fpm);
+  pmb.populateModulePassManager(mpm);
+}
+
+
+// Optimize the module at the given level (0 through 3). Level 0 only
+// lowers coroutines and applies profiling options. The module is 
+// configured for the host target so that the optimizer can use the 
+// target's data layout and cost model. Modules written for ThinLTO
+// are only optimized by the pre-link pipeline.
+void
+optimize(llvm::Module& mod, int level, Profile_options const& prof, Output_kind kind)
+{
+  apply_profile(mod, prof);
+
+  bool coro = has_coroutines(mod);
+  if (level <= 0 && !coro)
+    return;
+  if (level > 3)
+    level = 3;
+
+  std::unique_ptr<llvm::TargetMachine> tm = make_target_machine(level);
+  if (tm)
+    configure_module(mod, *tm);
+  llvm::Triple triple(mod.getTargetTriple());
+
+  llvm::legacy::FunctionPassManager fpm(&mod);
+  llvm::legacy::PassManager mpm;
+  mpm.add(new llvm::TargetLibraryInfoWrapperPass(triple));
+  if (tm) {
+    fpm.add(llvm::createTargetTransformInfoWrapperPass(tm->getTargetIRAnalysis()));
+    mpm.add(llvm::createTargetTransformInfoWrapperPass(tm->getTargetIRAnalysis()));
+  }
+
+  if (level <= 1) {
+    if (level == 1)
+      add_basic_passes(fpm);
+    if (coro)
+      add_coroutine_passes(mpm);
+  } else {
+    add_standard_passes(fpm, mpm, level, kind == thin_output);
+  }
+
+  fpm.doInitialization();
+  for (llvm::Function& f : mod)
+    fpm.run(f);
+  fpm.doFinalization();
+  mpm.run(mod);
+}
+
+
+} // namespace ll
+
+} // namespace banjo
@@ -0,0 +1,48 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#ifndef BANJO_OPTIMIZER_HPP
+#define BANJO_OPTIMIZER_HPP
+
+// Optimization of generated modules.
+
+#include "emitter.hpp"
+
+#include <banjo/prelude.hpp>
+
+
+namespace llvm
+{
+
+class Module;
+
+} // namespace llvm
+
+
+namespace banjo
+{
+
+namespace ll
+{
+
+// Options for profile-guided optimization. When generate is set,
+// the module is instrumented to write a raw profile to that file, 
+// unless LLVM_PROFILE_FILE is set when the program runs. When use is 
+// set, branch weights are read from that indexed profile (as produced 
+// by llvm-profdata merge).
+struct Profile_options
+{
+  String generate;
+  String use;
+};
+
+
+void optimize(llvm::Module&, int, Profile_options const& = {}, Output_kind = ir_output);
+
+
+} // namespace ll
+
+} // namespace banjo
+
+
+#endif
@@ -0,0 +1,89 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#include "parallel.hpp"
+#include "generator.hpp"
+#include "optimizer.hpp"
+
+#include <lingo/error.hpp>
+
+#include <llvm/IR/Module.h>
+
+#include <algorithm>
+#include <thread>
+
+
+namespace banjo
+{
+
+namespace ll
+{
+
+// Generate the translation unit in n shards, using one thread per
+// shard. Each shard is optimized at the given level and written to 
+// its own file. Shards written to stdout are emitted in order after 
+// all shards have been generated. Returns false if any shard could
+// not be generated or written.
+//
+// Errors thrown while generating a shard are caught in its thread, 
+// and diagnosed after all threads have finished.
+bool
+emit_parallel(Context& cxt, 
+              Translation_unit const& tu, 
+              int n, 
+              Output_kind kind, 
+              String const& path, 
+              int opt,
+              Profile_options const& prof)
+{
+  std::vector<std::unique_ptr<Generator>> gens;
+  gens.reserve(n);
+  for (int i = 0; i < n; ++i)
+    gens.emplace_back(new Generator(cxt, i, n));
+
+  bool serial = path == "-";
+  std::vector<char> ok(n, true);
+  std::vector<String> errs(n);
+  std::vector<std::thread> threads;
+  threads.reserve(n);
+  for (int i = 0; i < n; ++i) {
+    threads.emplace_back([&, i]() {
+      try {
+        Generator& gen = *gens[i];
+        llvm::Module* mod = gen(tu);
+        optimize(*mod, opt, prof, kind);
+        if (!serial)
+          ok[i] = emit(*mod, kind, get_shard_path(path, i), opt);
+      } catch (std::exception const& e) {
+        ok[i] = false;
+        errs[i] = e.what();
+      } catch (...) {
+        ok[i] = false;
+        errs[i] = "unknown error";
+      }
+    });
+  }
+  for (std::thread& t : threads)
+    t.join();
+
+  for (int i = 0; i < n; ++i) {
+    if (!errs[i].empty())
+      lingo::error("cannot generate shard {}: {}", i, errs[i]);
+  }
+
+  // Shards are only written to stdout if all of them were generated.
+  if (serial && std::all_of(ok.begin(), ok.end(), [](char b) { return b; })) {
+    for (int i = 0; i < n; ++i)
+      ok[i] = emit(*gens[i]->mod, kind, path, opt);
+  }
+
+  for (char b : ok)
+    if (!b)
+      return false;
+  return true;
+}
+
+
+} // namespace ll
+
+} // namespace banjo
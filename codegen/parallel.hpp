@@ -0,0 +1,32 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#ifndef BANJO_PARALLEL_HPP
+#define BANJO_PARALLEL_HPP
+
+// Parallel code generation. The translation unit is partitioned into
+// shards that are generated, optimized and emitted concurrently, each
+// into a separate output file.
+
+#include "emitter.hpp"
+#include "optimizer.hpp"
+
+#include <banjo/language.hpp>
+
+
+namespace banjo
+{
+
+namespace ll
+{
+
+bool emit_parallel(Context&, Translation_unit const&, int, Output_kind, 
+                   String const&, int, Profile_options const& = {});
+
+
+} // namespace ll
+
+} // namespace banjo
+
+
+#endif
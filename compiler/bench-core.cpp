@@ -0,0 +1,242 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+// Microbenchmarks for the core algorithms of the Banjo library. Each
+// benchmark runs a single routine over generated trees of a controlled
+// shape and size and reports the average time per call.
+//
+//    bench-banjo-core [-sizes n,m,...] [-json] [benchmark...]
+//
+// The benchmarks are:
+//
+//    type-hash    -- Type_hash on tuple types of depth n
+//    expr-hash    -- Expr_hash on balanced sums of depth n
+//    type-eq      -- is_equivalent on distinct but equal tuple types
+//    expr-eq      -- is_equivalent on distinct but equal sums
+//    lookup       -- unqualified_lookup in a scope of n declarations
+//    evaluate     -- Evaluator::evaluate on balanced sums of depth n
+//
+// Substitution, deduction, normalization, and subsumption are not yet
+// part of the library build, and so are not measured.
+
+#include <banjo/context.hpp>
+#include <banjo/ast.hpp>
+#include <banjo/hashing.hpp>
+#include <banjo/equivalence.hpp>
+#include <banjo/lookup.hpp>
+#include <banjo/declaration.hpp>
+#include <banjo/evaluation.hpp>
+
+#include <lingo/error.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+
+using namespace lingo;
+using namespace banjo;
+
+
+// Prevents the compiler from discarding the results of benchmarks.
+static volatile std::size_t sink;
+
+
+// Returns a tuple type of the given depth in which each tuple has two
+// elements. The leaves alternate between int and bool.
+Type&
+make_type(Context& cxt, int depth, int n = 0)
+{
+  if (depth == 0) {
+    if (n % 2)
+      return cxt.get_bool_type();
+    return cxt.get_int_type();
+  }
+  Type_list ts {
+    &make_type(cxt, depth - 1, 2 * n),
+    &make_type(cxt, depth - 1, 2 * n + 1)
+  };
+  return cxt.get_tuple_type(object_type, ts);
+}
+
+
+// Returns a balanced sum of integers with the given depth.
+Expr&
+make_expr(Context& cxt, int depth, int n = 0)
+{
+  Type& t = cxt.get_int_type();
+  if (depth == 0)
+    return cxt.get_integer(t, n);
+  Expr& l = make_expr(cxt, depth - 1, 2 * n);
+  Expr& r = make_expr(cxt, depth - 1, 2 * n + 1);
+  return cxt.make_add(t, l, r);
+}
+
+
+// Runs f repeatedly for at least a tenth of a second, returning the
+// average time of a call in nanoseconds.
+template<typename F>
+double
+measure(F f)
+{
+  using Clock = std::chrono::steady_clock;
+  std::chrono::duration<double, std::nano> min = std::chrono::milliseconds(100);
+  std::size_t iters = 0;
+  Clock::time_point start = Clock::now();
+  Clock::duration elapsed;
+  do {
+    for (int i = 0; i < 16; ++i)
+      f();
+    iters += 16;
+    elapsed = Clock::now() - start;
+  } while (elapsed < min);
+  std::chrono::duration<double, std::nano> t = elapsed;
+  return t.count() / iters;
+}
+
+
+double
+bench_type_hash(Context& cxt, int n)
+{
+  Type& t = make_type(cxt, n);
+  Type_hash h;
+  return measure([&]() { sink = h(&t); });
+}
+
+
+double
+bench_expr_hash(Context& cxt, int n)
+{
+  Expr& e = make_expr(cxt, n);
+  Expr_hash h;
+  return measure([&]() { sink = h(&e); });
+}
+
+
+double
+bench_type_eq(Context& cxt, int n)
+{
+  Type& t1 = make_type(cxt, n);
+  Type& t2 = make_type(cxt, n);
+  return measure([&]() { sink = is_equivalent(t1, t2); });
+}
+
+
+double
+bench_expr_eq(Context& cxt, int n)
+{
+  Expr& e1 = make_expr(cxt, n);
+  Expr& e2 = make_expr(cxt, n);
+  return measure([&]() { sink = is_equivalent(e1, e2); });
+}
+
+
+// Declare n variables in the global scope, and look up the last. The
+// time is that of a single lookup.
+double
+bench_lookup(Context& cxt, int n)
+{
+  Decl& tu = cxt.builtins().translation_unit();
+  Enter_scope scope(cxt, cxt.saved_scope(tu));
+  Type& t = cxt.get_int_type();
+  for (int i = 0; i < n; ++i) {
+    String name = "v" + std::to_string(i);
+    declare(cxt, cxt.make_variable_declaration(name.c_str(), t));
+  }
+  Name& id = cxt.get_id("v" + std::to_string(n - 1));
+  return measure([&]() { sink = unqualified_lookup(cxt, id).size(); });
+}
+
+
+double
+bench_evaluate(Context& cxt, int n)
+{
+  Expr& e = make_expr(cxt, n);
+  return measure([&]() {
+    Evaluator eval(cxt);
+    sink = (bool)eval.evaluate(e).get_integer();
+  });
+}
+
+
+using Bench_fn = double (*)(Context&, int);
+
+
+struct Benchmark
+{
+  char const*      name;
+  Bench_fn         fn;
+  std::vector<int> sizes; // The default sizes
+};
+
+
+Benchmark benchmarks[] {
+  {"type-hash", bench_type_hash, {2, 4, 8, 12}},
+  {"expr-hash", bench_expr_hash, {2, 4, 8, 12}},
+  {"type-eq", bench_type_eq, {2, 4, 8, 12}},
+  {"expr-eq", bench_expr_eq, {2, 4, 8, 12}},
+  {"lookup", bench_lookup, {10, 100, 1000, 10000}},
+  {"evaluate", bench_evaluate, {2, 4, 8, 12}},
+};
+
+
+int
+main(int argc, char* argv[])
+{
+  std::vector<Benchmark> selected;
+  std::vector<int> sizes;
+  bool json = false;
+  for (int i = 1; i < argc; ++i) {
+    String arg = argv[i];
+    if (arg == "-json") {
+      json = true;
+    } else if (arg == "-sizes" && i + 1 < argc) {
+      std::stringstream ss(argv[++i]);
+      String tok;
+      while (std::getline(ss, tok, ','))
+        sizes.push_back(std::max(1, std::atoi(tok.c_str())));
+    } else {
+      auto iter = std::find_if(std::begin(benchmarks), std::end(benchmarks), [&](Benchmark const& b) {
+        return arg == b.name;
+      });
+      if (iter == std::end(benchmarks)) {
+        error("unknown benchmark or option '{}'", arg);
+        return 1;
+      }
+      selected.push_back(*iter);
+    }
+  }
+  if (selected.empty())
+    selected.assign(std::begin(benchmarks), std::end(benchmarks));
+
+  if (!json) {
+    std::cout << std::left << std::setw(12) << "benchmark" << std::right
+              << std::setw(8) << "size"
+              << std::setw(14) << "ns/call"
+              << '\n';
+  }
+  for (Benchmark const& b : selected) {
+    for (int n : sizes.empty() ? b.sizes : sizes) {
+      // Use a fresh context for each run so that the memory
+      // retained by earlier runs does not affect later ones.
+      Symbol_table syms;
+      Context cxt(syms);
+      double t = b.fn(cxt, n);
+      if (json) {
+        std::cout << std::fixed << std::setprecision(1)
+                  << "{\"benchmark\":\"" << b.name << "\","
+                  << "\"size\":" << n << ','
+                  << "\"ns\":" << t << "}\n";
+      } else {
+        std::cout << std::fixed << std::setprecision(1)
+                  << std::left << std::setw(12) << b.name << std::right
+                  << std::setw(8) << n
+                  << std::setw(14) << t
+                  << '\n';
+      }
+    }
+  }
+}
@@ -0,0 +1,501 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+// A benchmark harness for the compiler. The harness generates Banjo
+// programs of a given shape at increasing sizes, translates each in
+// process with the pipeline of the driver, and reports the time spent
+// in each phase along with the throughput of translation and how it
+// scales with size. Generated code is discarded.
+//
+//    bench-banjo [options] [shape...]
+//
+// The shapes are:
+//
+//    functions    -- n small function definitions
+//    nesting      -- a function with n nested blocks
+//    overloads    -- an overload set of n functions
+//    expressions  -- a function returning a chain of n operators
+//    tuples       -- a variable with a tuple initializer of n elements
+//
+// The options are:
+//
+//    -sizes n,m,...  The sizes of generated programs
+//    -runs n         The number of runs of each program; the fastest
+//                    run is reported
+//    -json           Write results as JSON, one object per line
+//    -write dir      Write each generated program into dir
+//    -fold           Fold constant expressions, as in the driver
+//    -O<n>           Optimize generated code, as in the driver
+//
+// Note that classes are not generated since class bodies cannot
+// yet be parsed.
+
+#include "context.hpp"
+#include "driver.hpp"
+
+#include <lingo/file.hpp>
+#include <lingo/io.hpp>
+#include <lingo/error.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+
+using namespace lingo;
+using namespace banjo;
+
+
+// A generated program and the number of declarations it contains.
+struct Program
+{
+  String text;
+  int    decls;
+};
+
+
+using Generate_fn = Program (*)(int);
+
+
+// n function definitions, each with a local variable and a branch.
+Program
+gen_functions(int n)
+{
+  std::stringstream ss;
+  for (int i = 0; i < n; ++i) {
+    ss << "def f" << i << "(x : int) -> int {\n"
+       << "  var y : int = x + " << i << ";\n"
+       << "  if (y < 0)\n"
+       << "    return 0;\n"
+       << "  return y * 2;\n"
+       << "}\n\n";
+  }
+  return {ss.str(), 2 * n};
+}
+
+
+// A function with n nested blocks, each declaring a variable.
+Program
+gen_nesting(int n)
+{
+  std::stringstream ss;
+  ss << "def f(x : int) -> int {\n";
+  for (int i = 0; i < n; ++i) {
+    ss << "if (x < " << i << ") {\n"
+       << "var v" << i << " : int = x;\n";
+  }
+  for (int i = 0; i < n; ++i)
+    ss << "}\n";
+  ss << "return x;\n"
+     << "}\n";
+  return {ss.str(), n + 1};
+}
+
+
+// An overload set of n functions. Each overload has the same number
+// of parameters, which differ in their combination of int and bool
+// types. A caller selects the first overload.
+Program
+gen_overloads(int n)
+{
+  int m = 1;
+  while ((1 << m) < n)
+    ++m;
+
+  std::stringstream ss;
+  for (int i = 0; i < n; ++i) {
+    ss << "def g(";
+    for (int j = 0; j < m; ++j) {
+      if (j)
+        ss << ", ";
+      ss << 'a' << j << " : " << ((i >> j) & 1 ? "bool" : "int");
+    }
+    ss << ") -> int { return " << i << "; }\n";
+  }
+
+  ss << "\ndef f() -> int {\n"
+     << "  return g(";
+  for (int j = 0; j < m; ++j) {
+    if (j)
+      ss << ", ";
+    ss << '0';
+  }
+  ss << ");\n"
+     << "}\n";
+  return {ss.str(), n + 1};
+}
+
+
+// A function that returns a left-associative chain of n additive
+// operators.
+Program
+gen_expressions(int n)
+{
+  std::stringstream ss;
+  ss << "def f(x : int) -> int {\n"
+     << "  return x";
+  for (int i = 0; i < n; ++i) {
+    ss << (i % 2 ? " - " : " + ") << i;
+    if (i % 16 == 15)
+      ss << "\n    ";
+  }
+  ss << ";\n"
+     << "}\n";
+  return {ss.str(), 1};
+}
+
+
+// A variable whose tuple initializer has n elements.
+Program
+gen_tuples(int n)
+{
+  std::stringstream ts;
+  std::stringstream es;
+  for (int i = 0; i < n; ++i) {
+    if (i) {
+      ts << ", ";
+      es << ", ";
+    }
+    if (i % 16 == 15) {
+      ts << "\n  ";
+      es << "\n  ";
+    }
+    ts << "int";
+    es << i;
+  }
+  String text = "var t : {" + ts.str() + "} = {" + es.str() + "};\n";
+  return {text, 1};
+}
+
+
+struct Shape
+{
+  char const* name;
+  Generate_fn fn;
+};
+
+
+Shape shapes[] {
+  {"functions", gen_functions},
+  {"nesting", gen_nesting},
+  {"overloads", gen_overloads},
+  {"expressions", gen_expressions},
+  {"tuples", gen_tuples},
+};
+
+
+// The phases of translation reported by the harness. These are the
+// names of the spans recorded by the driver.
+char const* phases[] {
+  "lex",
+  "parse",
+  "elaborate declarations",
+  "elaborate expressions",
+  "fold constants",
+  "codegen",
+  "optimize",
+  "emit",
+};
+
+constexpr int num_phases = sizeof(phases) / sizeof(*phases);
+
+
+// Column headings for each phase.
+char const* labels[num_phases] {
+  "lex(ms)",
+  "parse(ms)",
+  "decls(ms)",
+  "exprs(ms)",
+  "fold(ms)",
+  "codegen(ms)",
+  "opt(ms)",
+  "emit(ms)",
+};
+
+
+// The result of translating a program. Times are in milliseconds.
+struct Result
+{
+  bool   ok;
+  double times[num_phases];
+  double total;
+};
+
+
+// Translate the file with the driver's pipeline, recording the time
+// spent in each phase. Generated code is written to /dev/null.
+Result
+translate(File& file, fe::Options const& opts)
+{
+  Result r {};
+  Symbol_table syms;
+  fe::Context cxt(syms);
+  cxt.time_trace().enable(true);
+
+  int errs = error_count();
+  try {
+    if (fe::translate(cxt, opts, {&file}, "/dev/null"))
+      return r;
+  } catch (Translation_error&) {
+    return r;
+  }
+  if (error_count() != errs)
+    return r;
+
+  // Accumulate the time spent in each phase.
+  for (Trace_event const& e : cxt.time_trace().events()) {
+    for (int i = 0; i < num_phases; ++i) {
+      if (e.name == String(phases[i])) {
+        r.times[i] += e.wall / 1000;
+        r.total += e.wall / 1000;
+      }
+    }
+  }
+  r.ok = true;
+  return r;
+}
+
+
+// Translate the file the given number of times, returning the
+// fastest translation.
+Result
+measure(File& file, fe::Options const& opts, int runs)
+{
+  Result best {};
+  for (int i = 0; i < runs; ++i) {
+    Result r = translate(file, opts);
+    if (!r.ok)
+      return r;
+    if (!best.ok || r.total < best.total)
+      best = r;
+  }
+  return best;
+}
+
+
+struct Options
+{
+  std::vector<Shape> shapes;
+  std::vector<int>   sizes = {100, 200, 400, 800};
+  int                runs  = 3;
+  bool               json  = false;
+  String             dir   = {};
+  bool               fold  = false;
+  int                opt   = 0;
+};
+
+
+// Returns the list of comma-separated sizes in arg.
+std::vector<int>
+parse_sizes(char const* arg)
+{
+  std::vector<int> ns;
+  std::stringstream ss(arg);
+  String tok;
+  while (std::getline(ss, tok, ',')) {
+    int n = std::atoi(tok.c_str());
+    if (n <= 0) {
+      error("invalid size '{}'", tok);
+      exit(1);
+    }
+    ns.push_back(n);
+  }
+  return ns;
+}
+
+
+void
+parse_args(int argc, char* argv[], Options& opts)
+{
+  for (int i = 1; i < argc; ++i) {
+    String arg = argv[i];
+    if (arg == "-sizes" || arg == "-runs" || arg == "-write") {
+      if (i + 1 == argc) {
+        error("expected an argument after '{}'", arg);
+        exit(1);
+      }
+      char const* val = argv[++i];
+      if (arg == "-sizes")
+        opts.sizes = parse_sizes(val);
+      else if (arg == "-runs")
+        opts.runs = std::max(1, std::atoi(val));
+      else
+        opts.dir = val;
+    } else if (arg == "-json") {
+      opts.json = true;
+    } else if (arg == "-fold") {
+      opts.fold = true;
+    } else if (arg.size() == 3 && arg.compare(0, 2, "-O") == 0 && arg[2] >= '0' && arg[2] <= '3') {
+      opts.opt = arg[2] - '0';
+    } else {
+      auto iter = std::find_if(std::begin(shapes), std::end(shapes), [&](Shape const& s) {
+        return arg == s.name;
+      });
+      if (iter == std::end(shapes)) {
+        error("unknown shape or option '{}'", arg);
+        exit(1);
+      }
+      opts.shapes.push_back(*iter);
+    }
+  }
+  if (opts.shapes.empty())
+    opts.shapes.assign(std::begin(shapes), std::end(shapes));
+}
+
+
+// Returns the number of lines in s.
+int
+count_lines(String const& s)
+{
+  return std::count(s.begin(), s.end(), '\n');
+}
+
+
+// Returns the number of items translated per second, or 0 if the
+// time is too short to measure.
+double
+get_rate(int n, double ms)
+{
+  if (ms <= 0)
+    return 0;
+  return n * 1000 / ms;
+}
+
+
+// Write the program to the file at path.
+void
+write_program(Program const& p, String const& path)
+{
+  std::ofstream os(path);
+  os << p.text;
+  os.close();
+  if (!os) {
+    error("cannot write '{}'", path);
+    exit(1);
+  }
+}
+
+
+void
+print_header()
+{
+  std::cout << std::left << std::setw(12) << "shape" << std::right
+            << std::setw(8) << "size"
+            << std::setw(8) << "lines"
+            << std::setw(8) << "decls";
+  for (char const* l : labels)
+    std::cout << std::setw(12) << l;
+  std::cout << std::setw(12) << "total(ms)"
+            << std::setw(12) << "lines/s"
+            << std::setw(12) << "decls/s"
+            << std::setw(8) << "scale"
+            << '\n';
+}
+
+
+// Print the result of a run. The scale is the exponent k for which
+// the total time grows as size^k relative to the previous size.
+void
+print_result(Shape const& s, int n, Program const& p, Result const& r, double scale)
+{
+  std::cout << std::left << std::setw(12) << s.name << std::right
+            << std::setw(8) << n
+            << std::setw(8) << count_lines(p.text)
+            << std::setw(8) << p.decls;
+  if (!r.ok) {
+    std::cout << "  failed\n";
+    return;
+  }
+  std::cout << std::fixed << std::setprecision(3);
+  for (double t : r.times)
+    std::cout << std::setw(12) << t;
+  std::cout << std::setw(12) << r.total
+            << std::setprecision(0)
+            << std::setw(12) << get_rate(count_lines(p.text), r.total)
+            << std::setw(12) << get_rate(p.decls, r.total)
+            << std::setprecision(2)
+            << std::setw(8) << scale
+            << '\n';
+}
+
+
+void
+print_json(Shape const& s, int n, Program const& p, Result const& r)
+{
+  std::cout << "{\"shape\":\"" << s.name << "\","
+            << "\"size\":" << n << ','
+            << "\"lines\":" << count_lines(p.text) << ','
+            << "\"decls\":" << p.decls << ','
+            << "\"ok\":" << (r.ok ? "true" : "false");
+  if (r.ok) {
+    std::cout << std::fixed << std::setprecision(3) << ",\"phases\":{";
+    for (int i = 0; i < num_phases; ++i) {
+      if (i)
+        std::cout << ',';
+      std::cout << '"' << phases[i] << "\":" << r.times[i];
+    }
+    std::cout << "},\"total\":" << r.total << ','
+              << "\"lines_per_s\":" << get_rate(count_lines(p.text), r.total) << ','
+              << "\"decls_per_s\":" << get_rate(p.decls, r.total);
+  }
+  std::cout << "}\n";
+}
+
+
+int
+main(int argc, char* argv[])
+{
+  Options opts;
+  parse_args(argc, argv, opts);
+
+  // Programs are translated from files, as by the driver. Unless they
+  // are kept, they are written to a temporary file.
+  namespace fs = boost::filesystem;
+  String temp = (fs::temp_directory_path() / fs::unique_path("bench-%%%%%%%%.banjo")).string();
+
+  fe::Options conf;
+  conf.fold = opts.fold;
+  conf.opt = opts.opt;
+
+  if (!opts.json)
+    print_header();
+
+  int failures = 0;
+  for (Shape const& s : opts.shapes) {
+    double prev_time = 0;
+    int prev_size = 0;
+    for (int n : opts.sizes) {
+      Program p = s.fn(n);
+      String path = temp;
+      if (!opts.dir.empty())
+        path = opts.dir + '/' + s.name + '-' + std::to_string(n) + ".banjo";
+      write_program(p, path);
+
+      File file(path.c_str());
+      Result r = measure(file, conf, opts.runs);
+      if (!r.ok)
+        ++failures;
+
+      double scale = 0;
+      if (r.ok && prev_time > 0 && prev_size != n)
+        scale = std::log(r.total / prev_time) / std::log(double(n) / prev_size);
+      if (r.ok) {
+        prev_time = r.total;
+        prev_size = n;
+      }
+
+      if (opts.json)
+        print_json(s, n, p, r);
+      else
+        print_result(s, n, p, r, scale);
+    }
+  }
+  fs::remove(temp);
+  return failures ? 1 : 0;
+}
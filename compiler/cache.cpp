@@ -0,0 +1,284 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#include "cache.hpp"
+
+#include <banjo/hashing.hpp>
+
+#include <lingo/error.hpp>
+
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/SHA1.h>
+
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <vector>
+
+
+namespace banjo
+{
+
+namespace fe
+{
+
+namespace fs = boost::filesystem;
+
+
+// Returns a hash of the kinds and spellings of the tokens, and of the
+// configuration string. The configuration must include everything,
+// other than the input, that affects the generated code.
+std::size_t
+hash_tokens(lingo::Token_seq const& toks, String const& config)
+{
+  fnv1a_hash h;
+  for (lingo::Token const& k : toks) {
+    String s = k.spelling();
+    int kind = k.kind();
+    h(&kind, sizeof(kind));
+    h(s.data(), s.size() + 1);
+  }
+  h(config.data(), config.size());
+  return h.state();
+}
+
+
+// Returns the key of the cache entry for the tokens: the configuration,
+// followed by the kind and spelling of each token. Spellings are
+// prefixed by their length so that distinct sequences of tokens have
+// distinct keys. The configuration must include everything, other than
+// the input, that affects the generated code.
+String
+get_cache_key(lingo::Token_seq const& toks, String const& config)
+{
+  std::stringstream ss;
+  ss << config.size() << ':' << config << '\n';
+  for (lingo::Token const& k : toks) {
+    String s = k.spelling();
+    ss << k.kind() << ' ' << s.size() << ':' << s << '\n';
+  }
+  return ss.str();
+}
+
+
+// Open the cache in the given directory, creating it if needed. The
+// size of the cache is bounded by limit bytes. Cumulative statistics
+// are read from the stats file in the directory.
+Cache::Cache(String const& d, std::uintmax_t n)
+  : dir(d), limit(n), hits(0), misses(0)
+{
+  boost::system::error_code err;
+  fs::create_directories(dir, err);
+  if (err)
+    lingo::error("cannot create cache directory '{}'", d);
+
+  std::ifstream is((dir / "stats").string());
+  is >> hits >> misses;
+}
+
+
+// Save cumulative statistics and remove any unstored output.
+Cache::~Cache()
+{
+  std::ofstream os((dir / "stats").string());
+  os << hits << ' ' << misses << '\n';
+
+  boost::system::error_code err;
+  if (!temp.empty())
+    fs::remove(temp, err);
+}
+
+
+// Returns the path of the entry for the given key. The name of the
+// entry is the digest of the key; its key is stored next to it, with
+// the extension .key.
+fs::path
+Cache::get_path(String const& key) const
+{
+  llvm::SHA1 h;
+  h.update(key);
+  return dir / (llvm::toHex(h.final()) + ".out");
+}
+
+
+// Returns true if the key stored with the entry p is the given key.
+bool
+Cache::matches(fs::path const& p, String const& key) const
+{
+  fs::path k = p;
+  std::ifstream is(k.replace_extension(".key").string(), std::ios::binary);
+  if (!is)
+    return false;
+  String s {std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>()};
+  return s == key;
+}
+
+
+// Copy the file to the output. If the output is "-", the file is
+// written to stdout.
+bool
+Cache::copy(fs::path const& p, String const& output)
+{
+  boost::system::error_code err;
+  if (output == "-") {
+    std::ifstream is(p.string(), std::ios::binary);
+    std::cout << is.rdbuf();
+    return bool(is);
+  }
+  fs::copy_file(p, output, fs::copy_option::overwrite_if_exists, err);
+  if (err) {
+    lingo::error("cannot write '{}': {}", output, err.message());
+    return false;
+  }
+  return true;
+}
+
+
+// If the cache has an entry for the key, copy it to the output and
+// mark the entry as recently used. Returns true on a hit. An entry
+// whose digest matches but whose key does not is a miss.
+bool
+Cache::fetch(String const& key, String const& output)
+{
+  fs::path p = get_path(key);
+  boost::system::error_code err;
+  if (!fs::exists(p, err) || !matches(p, key)) {
+    ++misses;
+    return false;
+  }
+  if (!copy(p, output))
+    return false;
+  fs::last_write_time(p, std::time(nullptr), err);
+  ++hits;
+  return true;
+}
+
+
+// Returns the path to which generated code should be written before
+// it is stored.
+String
+Cache::prepare()
+{
+  temp = dir / fs::unique_path("%%%%-%%%%-%%%%.tmp");
+  return temp.string();
+}
+
+
+// Move the prepared output into the cache with its key, and copy it
+// to the output. This may evict older entries, but never the entry
+// just stored.
+bool
+Cache::store(String const& key, String const& output)
+{
+  fs::path p = get_path(key);
+  fs::path k = p;
+  k.replace_extension(".key");
+  boost::system::error_code err;
+
+  // Write the key before the entry, so that the entry is never found
+  // with the key of another.
+  fs::remove(p, err);
+  {
+    std::ofstream os(k.string(), std::ios::binary);
+    os << key;
+    if (!os) {
+      lingo::error("cannot store '{}' in the cache", k.string());
+      return false;
+    }
+  }
+  fs::rename(temp, p, err);
+  if (err) {
+    lingo::error("cannot store '{}' in the cache: {}", p.string(), err.message());
+    return false;
+  }
+  temp.clear();
+  if (!copy(p, output))
+    return false;
+  evict(p);
+  return true;
+}
+
+
+// Remove the least recently used entries, other than the entry p,
+// until the cache fits within its limit. The size of an entry
+// includes the size of its key.
+void
+Cache::evict(fs::path const& keep)
+{
+  struct Entry
+  {
+    fs::path       path;
+    std::time_t    time;
+    std::uintmax_t size;
+  };
+
+  std::vector<Entry> ents;
+  std::uintmax_t total = 0;
+  boost::system::error_code err;
+  for (fs::directory_iterator i(dir, err), e; i != e; i.increment(err)) {
+    fs::path p = i->path();
+    if (p.extension() != ".out")
+      continue;
+    fs::path k = p;
+    k.replace_extension(".key");
+    Entry ent {p, fs::last_write_time(p, err), fs::file_size(p, err)};
+    std::uintmax_t n = fs::file_size(k, err);
+    if (!err)
+      ent.size += n;
+    total += ent.size;
+    if (p != keep)
+      ents.push_back(ent);
+  }
+  if (total <= limit)
+    return;
+
+  std::sort(ents.begin(), ents.end(), [](Entry const& a, Entry const& b) {
+    return a.time < b.time;
+  });
+  for (Entry const& ent : ents) {
+    if (total <= limit)
+      break;
+    fs::path k = ent.path;
+    fs::remove(ent.path, err);
+    fs::remove(k.replace_extension(".key"), err);
+    total -= ent.size;
+  }
+}
+
+
+void
+Cache::print_stats(std::ostream& os)
+{
+  std::size_t count = 0;
+  std::uintmax_t size = 0;
+  boost::system::error_code err;
+  for (fs::directory_iterator i(dir, err), e; i != e; i.increment(err)) {
+    fs::path p = i->path();
+    if (p.extension() == ".out")
+      ++count;
+    if (p.extension() == ".out" || p.extension() == ".key") {
+      std::uintmax_t n = fs::file_size(p, err);
+      if (!err)
+        size += n;
+    }
+  }
+
+  std::size_t total = hits + misses;
+  os << "-- cache statistics --\n";
+  os << "hits:    " << hits << '\n';
+  os << "misses:  " << misses << '\n';
+  if (total)
+    os << "rate:    " << std::fixed << std::setprecision(1)
+       << 100.0 * hits / total << "%\n";
+  os << "entries: " << count << '\n';
+  os << "size:    " << size << " of " << limit << " bytes\n";
+}
+
+
+} // namespace fe
+
+} // namespace banjo
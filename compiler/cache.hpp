@@ -0,0 +1,62 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#ifndef BANJO_CACHE_HPP
+#define BANJO_CACHE_HPP
+
+// An on-disk cache of generated code. Entries are keyed by the tokens
+// of a translation unit and the configuration of the compiler, so that
+// edits to whitespace and comments do not cause recompilation. Each
+// entry is named by a SHA-1 digest of its key, and the key is stored
+// with the entry so that a hit is only taken when the keys are equal.
+// The cache is bounded in size; when it grows too large, the least
+// recently used entries are evicted.
+
+#include <banjo/prelude.hpp>
+
+#include <lingo/token.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <iosfwd>
+
+
+namespace banjo
+{
+
+namespace fe
+{
+
+std::size_t hash_tokens(lingo::Token_seq const&, String const&);
+String get_cache_key(lingo::Token_seq const&, String const&);
+
+
+struct Cache
+{
+  Cache(String const&, std::uintmax_t);
+  ~Cache();
+
+  bool fetch(String const&, String const&);
+  String prepare();
+  bool store(String const&, String const&);
+  void print_stats(std::ostream&);
+
+  boost::filesystem::path get_path(String const&) const;
+  bool matches(boost::filesystem::path const&, String const&) const;
+  bool copy(boost::filesystem::path const&, String const&);
+  void evict(boost::filesystem::path const&);
+
+  boost::filesystem::path dir;    // The cache directory
+  boost::filesystem::path temp;   // Output of the current translation
+  std::uintmax_t          limit;  // The maximum size of the cache
+  std::size_t             hits;   // Cumulative cache hits
+  std::size_t             misses; // Cumulative cache misses
+};
+
+
+} // namespace fe
+
+} // namespace banjo
+
+
+#endif
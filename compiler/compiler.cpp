@@ -2,60 +2,297 @@
 // All rights reserved
 
 #include "context.hpp"
-#include "lexer.hpp"
-#include "parser.hpp"
-#include "printer.hpp"
+#include "options.hpp"
+#include "driver.hpp"
+#include "server.hpp"
 
-#include "elab-declarations.hpp"
-#include "elab-expressions.hpp"
-// #include "elab-classes.hpp"
-
-#include <banjo/ast.hpp>
-
-#include <codegen/generator.hpp>
+#include <codegen/emitter.hpp>
 
 #include <lingo/file.hpp>
 #include <lingo/io.hpp>
 #include <lingo/error.hpp>
 
+#include <llvm/Config/llvm-config.h>
+
+#include <boost/filesystem.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
 #include <iostream>
+#include <sstream>
+#include <unordered_map>
 
 
 using namespace lingo;
 using namespace banjo;
 
 
-using File_seq = std::vector<File*>;
+using fe::File_seq;
+using fe::Options;
 
 
-struct Options
+using Parse_fn = void (*)(int&, int, char**, Options&);
+using Options_map = std::unordered_map<String, Parse_fn>;
+
+
+void
+parse_emit(int& argn, int argc, char* argv[], Options& opts)
 {
-  ~Options();
+  if (argn == argc) {
+    error("expected one of 'ast|banjo|cxx|llvm' after '-emit'");
+    exit(1);
+  }
+  opts.emit = argv[++argn];
+}
 
-  String   emit    = "llvm";
-  File_seq inputs  = {};
-};
 
+// Write generated code to the given file. If the file is "-", the
+// output is written to stdout.
+void
+parse_output(int& argn, int argc, char* argv[], Options& opts)
+{
+  if (argn + 1 == argc) {
+    error("expected a file name after '-o'");
+    exit(1);
+  }
+  opts.output = argv[++argn];
+}
 
-Options::~Options()
+
+// Write generated code as native object code.
+void
+parse_emit_obj(int& argn, int argc, char* argv[], Options& opts)
 {
-  for (File* f : inputs)
-    delete f;
+  opts.kind = ll::object_output;
 }
 
 
-using Parse_fn = void (*)(int&, int, char**, Options&);
-using Options_map = std::unordered_map<String, Parse_fn>;
+// Write generated code as LLVM bitcode.
+void
+parse_emit_bc(int& argn, int argc, char* argv[], Options& opts)
+{
+  opts.kind = ll::bitcode_output;
+}
 
 
+// Set the optimization level from an option of the form -O<n>.
 void
-parse_emit(int& argn, int argc, char* argv[], Options& opts)
+parse_opt(int& argn, int argc, char* argv[], Options& opts)
 {
-  if (argn == argc) {
-    error("expected one of 'banjo|cxx|llvm' after '-emit'");
+  opts.opt = argv[argn][2] - '0';
+}
+
+
+// Instrument generated code to write an execution profile. The
+// profile is written to default.profraw unless LLVM_PROFILE_FILE is
+// set when running the program.
+void
+parse_profile_generate(int& argn, int argc, char* argv[], Options& opts)
+{
+  opts.pgo.generate = "default.profraw";
+}
+
+
+// Instrument generated code to write an execution profile to the file
+// given by an option of the form -fprofile-generate=<file>. 
+void
+parse_profile_generate_file(int& argn, int argc, char* argv[], Options& opts)
+{
+  char const* file = std::strchr(argv[argn], '=') + 1;
+  if (*file == 0) {
+    error("expected a file name after '-fprofile-generate='");
     exit(1);
   }
-  opts.emit = argv[++argn];
+  opts.pgo.generate = file;
+}
+
+
+// Optimize using an indexed profile, merged from the raw profiles of 
+// an instrumented build.
+void
+parse_profile_use(int& argn, int argc, char* argv[], Options& opts)
+{
+  if (argn + 1 == argc) {
+    error("expected a file name after '-fprofile-use'");
+    exit(1);
+  }
+  opts.pgo.use = argv[++argn];
+}
+
+
+// Compile each input separately to bitcode with a ThinLTO summary.
+void
+parse_thinlto(int& argn, int argc, char* argv[], Options& opts)
+{
+  opts.kind = ll::thin_output;
+}
+
+
+// Link ThinLTO bitcode files, producing one object file per module.
+void
+parse_thinlto_link(int& argn, int argc, char* argv[], Options& opts)
+{
+  opts.link = true;
+}
+
+
+// Enable constant folding of the elaborated translation unit.
+void
+parse_fold(int& argn, int argc, char* argv[], Options& opts)
+{
+  opts.fold = true;
+}
+
+
+// Print the size and padding of each generated class.
+void
+parse_layout_stats(int& argn, int argc, char* argv[], Options& opts)
+{
+  opts.layout.stats = true;
+}
+
+
+// Print the time and memory spent in each phase of translation.
+void
+parse_time_report(int& argn, int argc, char* argv[], Options& opts)
+{
+  opts.report = true;
+}
+
+
+// Write a trace of translation in the Chrome trace event format.
+void
+parse_time_trace(int& argn, int argc, char* argv[], Options& opts)
+{
+  opts.trace = true;
+}
+
+
+// Print the number and size of the nodes allocated by each translation.
+void
+parse_stats(int& argn, int argc, char* argv[], Options& opts)
+{
+  opts.stats = true;
+}
+
+
+// Print diagnostics as JSON objects, one per line, after translation.
+void
+parse_diagnostics_json(int& argn, int argc, char* argv[], Options& opts)
+{
+  opts.diags = json_format;
+}
+
+
+// Cache generated code in the given directory.
+void
+parse_cache(int& argn, int argc, char* argv[], Options& opts)
+{
+  if (argn + 1 == argc) {
+    error("expected a directory after '-cache'");
+    exit(1);
+  }
+  opts.cache = argv[++argn];
+}
+
+
+// Print cache statistics after translation.
+void
+parse_cache_stats(int& argn, int argc, char* argv[], Options& opts)
+{
+  opts.hits = true;
+}
+
+
+// Returns the numeric argument of the current option.
+std::size_t
+parse_count(int& argn, int argc, char* argv[])
+{
+  char const* opt = argv[argn];
+  if (argn + 1 == argc) {
+    error("expected a number after '{}'", opt);
+    exit(1);
+  }
+  char const* arg = argv[++argn];
+  char* end;
+  unsigned long n = std::strtoul(arg, &end, 10);
+  if (*arg == 0 || *end != 0) {
+    error("invalid number '{}' after '{}'", arg, opt);
+    exit(1);
+  }
+  return n;
+}
+
+
+// Limit the number of steps in a single constant evaluation. A
+// limit of 0 means unbounded.
+void
+parse_eval_steps(int& argn, int argc, char* argv[], Options& opts)
+{
+  opts.limits.steps = parse_count(argn, argc, argv);
+}
+
+
+// Limit the nesting of steps in a constant evaluation. A limit of 0 
+// means unbounded.
+void
+parse_eval_depth(int& argn, int argc, char* argv[], Options& opts)
+{
+  opts.limits.depth = parse_count(argn, argc, argv);
+}
+
+
+// Print a profile of constant evaluation after compilation. Work is
+// attributed to the declaration whose initializer or body was being
+// evaluated or folded. Function calls are not evaluated, so there are
+// no entries for the functions called.
+void
+parse_eval_profile(int& argn, int argc, char* argv[], Options& opts)
+{
+  opts.profile = true;
+}
+
+
+// Limit the size of the cache, in megabytes.
+void
+parse_cache_size(int& argn, int argc, char* argv[], Options& opts)
+{
+  opts.limit = parse_count(argn, argc, argv);
+}
+
+
+// Generate code in the given number of shards, in parallel. Each
+// shard is written to a separate output file.
+void
+parse_shards(int& argn, int argc, char* argv[], Options& opts)
+{
+  opts.shards = parse_count(argn, argc, argv);
+  if (opts.shards < 1) {
+    error("expected a positive number of shards");
+    exit(1);
+  }
+}
+
+
+// Run as a persistent compile server, reading requests from stdin.
+void
+parse_server(int& argn, int argc, char* argv[], Options& opts)
+{
+  opts.server = true;
+}
+
+
+// Import the declarations of a translation unit written with
+// '-emit ast'.
+void
+parse_import(int& argn, int argc, char* argv[], Options& opts)
+{
+  if (argn + 1 == argc) {
+    error("expected a file name after '-import'");
+    exit(1);
+  }
+  opts.imports.push_back(argv[++argn]);
 }
 
 
@@ -63,6 +300,7 @@ void
 parse_positional(int& argn, int argc, char* argv[], Options& opts)
 {
   opts.inputs.push_back(new File(argv[argn]));
+  opts.paths.push_back(argv[argn]);
 }
 
 
@@ -70,7 +308,34 @@ void
 parse_args(int argc, char* argv[], Options& opts)
 {
   static Options_map all {
-    {"-emit", parse_emit}
+    {"-emit", parse_emit},
+    {"-emit-obj", parse_emit_obj},
+    {"-emit-bc", parse_emit_bc},
+    {"-o", parse_output},
+    {"-O0", parse_opt},
+    {"-O1", parse_opt},
+    {"-O2", parse_opt},
+    {"-O3", parse_opt},
+    {"-shards", parse_shards},
+    {"-fprofile-generate", parse_profile_generate},
+    {"-fprofile-generate=", parse_profile_generate_file},
+    {"-fprofile-use", parse_profile_use},
+    {"-thinlto", parse_thinlto},
+    {"-thinlto-link", parse_thinlto_link},
+    {"-layout-stats", parse_layout_stats},
+    {"-fold", parse_fold},
+    {"-eval-steps", parse_eval_steps},
+    {"-eval-depth", parse_eval_depth},
+    {"-eval-profile", parse_eval_profile},
+    {"-ftime-report", parse_time_report},
+    {"-ftime-trace", parse_time_trace},
+    {"-stats", parse_stats},
+    {"-fdiagnostics-format=json", parse_diagnostics_json},
+    {"-cache", parse_cache},
+    {"-cache-size", parse_cache_size},
+    {"-cache-stats", parse_cache_stats},
+    {"-server", parse_server},
+    {"-import", parse_import}
   };
 
 
@@ -78,6 +343,12 @@ parse_args(int argc, char* argv[], Options& opts)
     char const* arg = argv[i];
     if (arg[0] == '-') {
       auto iter = all.find(arg);
+
+      // Options of the form -name=value are keyed by "-name=".
+      char const* eq = std::strchr(arg, '=');
+      if (iter == all.end() && eq)
+        iter = all.find(String(arg, eq + 1));
+
       if (iter == all.end()) {
         error("unknown option '{}'", argv[i]);
         exit(1);
@@ -90,15 +361,59 @@ parse_args(int argc, char* argv[], Options& opts)
 }
 
 
+// Returns an identifier of this build of the compiler: its version,
+// the version of LLVM, and the size and modification time of the
+// executable, so that rebuilding the compiler changes the identifier
+// even when its version does not. Returns an empty string if the
+// executable cannot be found.
+String
+get_build_id(char const* program)
+{
+  namespace fs = boost::filesystem;
+  boost::system::error_code err;
+  fs::path exe = fs::read_symlink("/proc/self/exe", err);
+  if (err)
+    exe = fs::system_complete(program, err);
+  std::uintmax_t size = fs::file_size(exe, err);
+  if (err)
+    return {};
+  std::time_t time = fs::last_write_time(exe, err);
+  if (err)
+    return {};
+
+  std::stringstream ss;
+  ss << BANJO_VERSION << ' ' << LLVM_VERSION_STRING << ' '
+     << size << ' ' << time;
+  return ss.str();
+}
+
+
+// Returns the name of a file written for the given input, which
+// replaces its extension with ext (e.g., .bc for ThinLTO bitcode).
+String
+get_input_path(String const& path, char const* ext)
+{
+  std::size_t dot = path.rfind('.');
+  std::size_t sep = path.rfind('/');
+  if (dot == String::npos || (sep != String::npos && dot < sep))
+    return path + ext;
+  return path.substr(0, dot) + ext;
+}
+
 
 int
 main(int argc, char* argv[])
 {
-  Symbol_table syms;
-  fe::Context cxt(syms);
-
   Options opts;
   parse_args(argc, argv, opts);
+  if (!opts.cache.empty())
+    opts.build = get_build_id(argv[0]);
+
+  // Inputs are given with each request to the server.
+  if (opts.server) {
+    fe::Server server(opts);
+    return server();
+  }
 
   // Check post-configuration options.
   if (opts.inputs.empty()) {
@@ -106,56 +421,54 @@ main(int argc, char* argv[])
     return -1;
   }
 
-  // Initial file processing.
-
-  // Perform character and lexical analysis.
-  Token_seq toks;
-  for (File* f : opts.inputs) {
-    Character_stream cs(*f);
-    Token_stream ts;
-    fe::Lexer lex(cxt, cs, ts);
-
-    // Lex the file and splice its tokens into the input stream.
-    lex();
-    if (error_count())
-      return 1;
-    toks.splice(toks.end(), ts.buf_);
+  // Link ThinLTO modules into object files.
+  if (opts.link) {
+    String output = opts.output.empty() ? "a.o" : opts.output;
+    return ll::thin_link(opts.paths, output, opts.opt) ? 0 : 1;
   }
 
-  // Perform syntactic analysis.
-  Token_stream ts(toks);
-  fe::Parser parse(cxt, ts);
-  parse();
-
-  // Elaboration passes.
-  fe::elaborate<fe::Elaborate_declarations>(parse);
-  fe::elaborate<fe::Elaborate_expressions>(parse);
-
-  // Elaborate_overloads    overloads(*this);
-  // Elaborate_classes      classes(*this);
-  // Elaborate_expressions  expressions(*this);
-
-
-  // // TODO: Transform abbreviated templates into templates.
-
-  // overloads(tu);    // Analyze overloaded/reopened declarations
-  // classes(tu);      // Complete class definitions
-  // expressions(tu);  // Update expressions
-
-
-  if (opts.emit == "tokens") {
-    for (Token k : toks)
-      std::cout << k << ' ';
-    std::cout << '\n';
-  }
-  else if (opts.emit == "banjo") {
-    std::cout << cxt.translation_unit() << '\n';
+  // Compile each input separately to ThinLTO bitcode. The output
+  // name only applies when there is a single input.
+  //
+  // Inputs see each other's declarations through interfaces: the
+  // declarations of each input are written next to its bitcode (as
+  // .ast), and imported by the inputs that follow it. Definitions are
+  // only shared at link time. This limits what can be split across
+  // inputs:
+  //
+  //    - inputs must be given in dependency order; an input cannot
+  //      use the declarations of an input that follows it, so
+  //      declarations that depend on each other must be in the same
+  //      input,
+  //    - imported functions cannot be evaluated at compile time, and
+  //      imported constants cannot be folded, since their definitions
+  //      are not imported, and
+  //    - coroutines cannot be called from other inputs, since their
+  //      signature depends on their definition.
+  if (opts.kind == ll::thin_output) {
+    for (std::size_t i = 0; i < opts.inputs.size(); ++i) {
+      String output = get_input_path(opts.paths[i], ".bc");
+      if (opts.inputs.size() == 1 && !opts.output.empty())
+        output = opts.output;
+      opts.iface = get_input_path(opts.paths[i], ".ast");
+      if (int err = fe::translate(opts, {opts.inputs[i]}, output))
+        return err;
+      opts.imports.push_back(opts.iface);
+    }
+    return 0;
   }
-  else if (opts.emit == "llvm") {
-    std::cout << "-- parsed --\n";
-    std::cout << cxt.translation_unit() << '\n';
-    std::cout << "-- generating --\n";
-    ll::Generator gen(cxt);
-    gen(cxt.translation_unit());
+
+  // Binary output is not written to stdout by default.
+  String output = opts.output;
+  if (output.empty()) {
+    switch (opts.kind) {
+      case ll::ir_output: output = "-"; break;
+      case ll::bitcode_output: output = "a.bc"; break;
+      case ll::object_output: output = "a.o"; break;
+      default: break;
+    }
+    if (opts.emit == "ast")
+      output = "a.ast";
   }
+  return fe::translate(opts, opts.inputs, output);
 }
@@ -3,6 +3,9 @@
 
 #include "context.hpp"
 #include "token.hpp"
+#include "parser.hpp"
+
+#include <banjo/ast.hpp>
 
 #include <lingo/io.hpp>
 
@@ -13,10 +16,78 @@ namespace banjo
 namespace fe
 {
 
+// Returns the parsed form of t. The type is parsed in the current scope.
+static Type&
+parse_type(Context& cxt, Type& t)
+{
+  if (Unparsed_type* u = as<Unparsed_type>(&t)) {
+    Save_input_location loc(cxt);
+    Token_stream ts(u->tokens());
+    Parser p(cxt, ts);
+    return p.type();
+  }
+  return t;
+}
+
+
+// Returns the parsed form of e. The expression is parsed in the current
+// scope.
+static Expr&
+parse_expr(Context& cxt, Expr& e)
+{
+  if (Unparsed_expr* u = as<Unparsed_expr>(&e)) {
+    Save_input_location loc(cxt);
+    Token_stream ts(u->tokens());
+    Parser p(cxt, ts);
+    return p.expression();
+  }
+  return e;
+}
+
+
+// Computes the type of a declaration, parsing it as needed. The type
+// of a function is computed from the types of its parameters, so that
+// it depends on them.
+static Query_result
+get_type(Context& cxt, Term& t)
+{
+  if (Function_decl* f = as<Function_decl>(&t)) {
+    Type_list ts;
+    for (Decl& p : f->parameters())
+      ts.push_back(type_of(cxt, p));
+    Type& ret = parse_type(cxt, f->return_type());
+    return {&cxt.get_function_type(std::move(ts), ret)};
+  }
+  return {&parse_type(cxt, cast<Typed_decl>(t).type())};
+}
+
+
+// Computes the definition of a declaration, parsing the expression of
+// an expression definition as needed.
+static Query_result
+get_body(Context& cxt, Term& t)
+{
+  struct fn
+  {
+    Def& operator()(Decl& d)          { lingo_unhandled(d); }
+    Def& operator()(Variable_decl& d) { return d.initializer(); }
+    Def& operator()(Function_decl& d) { return d.definition(); }
+    Def& operator()(Class_decl& d)    { return d.definition(); }
+  };
+  Def& def = apply(cast<Decl>(t), fn{});
+  if (Expression_def* e = as<Expression_def>(&def))
+    e->expr_ = &parse_expr(cxt, e->expression());
+  return {&def};
+}
+
+
+// Semantic queries elaborate declarations on demand.
 Context::Context(Symbol_table& s)
   : banjo::Context(s)
 {
   init_tokens(symbols());
+  queries().provide(type_query, [this](Term& t) { return get_type(*this, t); });
+  queries().provide(body_query, [this](Term& t) { return get_body(*this, t); });
 }
 
 
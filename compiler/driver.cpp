@@ -0,0 +1,456 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#include "driver.hpp"
+#include "context.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "cache.hpp"
+
+#include "elab-declarations.hpp"
+#include "elab-expressions.hpp"
+#include "elab-constants.hpp"
+
+#include <banjo/ast.hpp>
+#include <banjo/serialization.hpp>
+
+#include <codegen/generator.hpp>
+#include <codegen/emitter.hpp>
+#include <codegen/optimizer.hpp>
+#include <codegen/parallel.hpp>
+
+#include <lingo/io.hpp>
+#include <lingo/error.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+
+namespace banjo
+{
+
+namespace fe
+{
+
+using namespace lingo;
+
+
+// Print the evaluation profile, with the most expensive evaluations 
+// first. Evaluations outside of any declaration are attributed to
+// the translation unit.
+static void
+print_profile(Context& cxt)
+{
+  using Entry = std::pair<Decl const*, Evaluation_record>;
+  Evaluation_profile const& prof = cxt.evaluation_profile();
+  std::vector<Entry> ents(prof.begin(), prof.end());
+  std::sort(ents.begin(), ents.end(), [](Entry const& a, Entry const& b) {
+    return a.second.time > b.second.time;
+  });
+
+  std::cerr << "-- evaluation profile --\n";
+  std::cerr << std::setw(12) << "time (ms)"
+            << std::setw(10) << "calls" 
+            << std::setw(12) << "steps" 
+            << "  declaration\n";
+  for (Entry const& e : ents) {
+    Evaluation_record const& r = e.second;
+    std::cerr << std::fixed << std::setprecision(3)
+              << std::setw(12) << r.time * 1000
+              << std::setw(10) << r.calls
+              << std::setw(12) << r.steps << "  ";
+    if (e.first && !is<Translation_unit>(e.first))
+      std::cerr << e.first->name() << '\n';
+    else
+      std::cerr << "<translation unit>\n";
+  }
+}
+
+
+// Print the total time, processor time, and allocation of each phase of
+// translation, with the most expensive phases first. Nested spans are
+// included in the totals of enclosing phases.
+static void
+print_time_report(Context& cxt)
+{
+  struct Total
+  {
+    String      name;
+    std::size_t count;
+    double      wall;
+    double      cpu;
+    std::size_t bytes;
+  };
+  std::vector<Total> ts;
+  for (Trace_event const& e : cxt.time_trace().events()) {
+    auto iter = std::find_if(ts.begin(), ts.end(), [&](Total const& t) {
+      return t.name == e.name;
+    });
+    if (iter == ts.end())
+      iter = ts.insert(ts.end(), {e.name, 0, 0, 0, 0});
+    ++iter->count;
+    iter->wall += e.wall;
+    iter->cpu += e.cpu;
+    iter->bytes += e.bytes;
+  }
+  std::sort(ts.begin(), ts.end(), [](Total const& a, Total const& b) {
+    return a.wall > b.wall;
+  });
+
+  std::cerr << "-- time report --\n";
+  std::cerr << std::setw(12) << "wall (ms)"
+            << std::setw(12) << "cpu (ms)"
+            << std::setw(12) << "bytes"
+            << std::setw(10) << "spans"
+            << "  phase\n";
+  for (Total const& t : ts) {
+    std::cerr << std::fixed << std::setprecision(3)
+              << std::setw(12) << t.wall / 1000
+              << std::setw(12) << t.cpu / 1000
+              << std::setw(12) << t.bytes
+              << std::setw(10) << t.count
+              << "  " << t.name << '\n';
+  }
+}
+
+
+// Returns the unqualified name of a node class.
+static String
+get_node_name(std::type_index t)
+{
+  int status;
+  char* buf = abi::__cxa_demangle(t.name(), nullptr, nullptr, &status);
+  if (!buf)
+    return t.name();
+  String name = buf;
+  std::free(buf);
+  std::size_t sep = name.rfind("::");
+  if (sep != String::npos)
+    name = name.substr(sep + 2);
+  return name;
+}
+
+
+// Print the number and size of nodes allocated for each node class,
+// with the largest classes first. Built-in entities are allocated
+// before statistics are enabled, and so are not counted. This is
+// followed by a summary of semantic queries.
+static void
+print_stats(Context& cxt)
+{
+  using Entry = std::pair<std::type_index, Allocation_record>;
+  Allocation_stats const& stats = cxt.allocation_stats();
+  std::vector<Entry> ents(stats.begin(), stats.end());
+  std::sort(ents.begin(), ents.end(), [](Entry const& a, Entry const& b) {
+    return a.second.bytes > b.second.bytes;
+  });
+
+  std::cerr << "-- allocation statistics --\n";
+  std::cerr << std::setw(10) << "count"
+            << std::setw(12) << "bytes"
+            << "  node\n";
+  std::size_t count = 0;
+  std::size_t bytes = 0;
+  for (Entry const& e : ents) {
+    Allocation_record const& r = e.second;
+    std::cerr << std::setw(10) << r.count
+              << std::setw(12) << r.bytes
+              << "  " << get_node_name(e.first) << '\n';
+    count += r.count;
+    bytes += r.bytes;
+  }
+  std::cerr << std::setw(10) << count
+            << std::setw(12) << bytes
+            << "  total\n";
+  std::cerr << "peak arena size: " << cxt.allocated() << " bytes\n";
+
+  Query_stats const& qs = cxt.queries().stats();
+  std::cerr << "queries: " << qs.misses << " computed, "
+            << qs.hits << " reused, "
+            << qs.invalidations << " invalidated\n";
+}
+
+
+// Returns s as a JSON string.
+static String
+quote(String const& s)
+{
+  String r = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\')
+      r += '\\';
+    if ((unsigned char)c >= ' ')
+      r += c;
+  }
+  return r + '"';
+}
+
+
+// Write each span of translation as a complete event in the Chrome
+// trace event format. The file can be loaded by chrome://tracing.
+static bool
+write_time_trace(Context& cxt, String const& path)
+{
+  std::ofstream os(path);
+  if (!os) {
+    error("cannot open '{}' for writing", path);
+    return false;
+  }
+
+  os << "{\"traceEvents\":[";
+  bool first = true;
+  for (Trace_event const& e : cxt.time_trace().events()) {
+    if (!first)
+      os << ',';
+    first = false;
+
+    String detail;
+    if (e.decl) {
+      std::stringstream ss;
+      ss << e.decl->name();
+      detail = ss.str();
+    }
+    os << std::fixed << std::setprecision(3) << "\n"
+       << "{\"name\":" << quote(detail.empty() ? e.name : detail) << ','
+       << "\"cat\":" << quote(e.name) << ','
+       << "\"ph\":\"X\","
+       << "\"pid\":1,"
+       << "\"tid\":" << e.thread << ','
+       << "\"ts\":" << e.start << ','
+       << "\"dur\":" << e.wall << ','
+       << "\"args\":{\"cpu\":" << e.cpu << ",\"bytes\":" << e.bytes << "}}";
+  }
+  os << "\n]}\n";
+  return true;
+}
+
+
+// Returns the name of the trace file for the given output, which
+// replaces its extension with .json.
+static String
+get_trace_path(String const& path)
+{
+  if (path == "-")
+    return "a.json";
+  std::size_t dot = path.rfind('.');
+  std::size_t sep = path.rfind('/');
+  if (dot == String::npos || (sep != String::npos && dot < sep))
+    return path + ".json";
+  return path.substr(0, dot) + ".json";
+}
+
+
+// Returns true if the generated code can be cached. Sharded output
+// is written to several files, and profiles used for optimization
+// and imported files are not part of the cache key, so none of
+// them are cached. Neither is the output of inputs whose interface
+// is written for other inputs. Reports are written as a side effect
+// of translation, so nothing is cached when one is requested, and
+// nothing is cached when the build of the compiler is not known.
+static bool
+is_cacheable(Options const& opts)
+{
+  return !opts.cache.empty() 
+      && !opts.build.empty()
+      && opts.emit == "llvm" 
+      && opts.shards == 1 
+      && opts.pgo.use.empty()
+      && opts.imports.empty()
+      && opts.iface.empty()
+      && !opts.stats
+      && !opts.report
+      && !opts.trace
+      && !opts.profile
+      && !opts.layout.stats;
+}
+
+
+// Returns a description of the compiler and the options that affect
+// generated code. This is part of each cache key.
+static String
+get_configuration(Options const& opts)
+{
+  std::stringstream ss;
+  ss << opts.build << ' '
+     << opts.kind << ' '
+     << opts.opt << ' '
+     << opts.pgo.generate << ' '
+     << opts.fold << ' '
+     << opts.layout.stats << ' '
+     << opts.limits.steps << ' '
+     << opts.limits.depth;
+  return ss.str();
+}
+
+
+// Translate the files as a single translation unit in the given
+// context, writing generated code to the output file. The context is
+// configured by the options, although a caller may enable its time
+// trace beforehand. Returns a non-zero value on failure.
+int
+translate(Context& cxt, Options const& opts, File_seq const& files, String const& output)
+{
+  cxt.evaluation_limits() = opts.limits;
+  cxt.profile_evaluation(opts.profile);
+  cxt.layout_options() = opts.layout;
+  if (opts.report || opts.trace)
+    cxt.time_trace().enable(true);
+  cxt.count_allocations(opts.stats);
+  cxt.diagnostics().format = opts.diags;
+  cxt.diagnostics().deferred = opts.diags == json_format;
+  int errs = error_count();
+
+  // Initial file processing.
+
+  // Open the imported files before parsing. Their declarations are
+  // read when lookup fails to find a name in the program.
+  for (String const& p : opts.imports) {
+    Time_scope span(cxt, "import");
+    if (!cxt.import(p))
+      return 1;
+  }
+
+  // Perform character and lexical analysis.
+  Token_seq toks;
+  for (File* f : files) {
+    Time_scope span(cxt, "lex");
+    Character_stream cs(*f);
+    Token_stream ts;
+    Lexer lex(cxt, cs, ts);
+
+    // Lex the file and splice its tokens into the input stream.
+    lex();
+    if (error_count() != errs)
+      return 1;
+    toks.splice(toks.end(), ts.buf_);
+  }
+
+  // Reuse previously generated code for the same tokens. Otherwise,
+  // generate code into the cache.
+  std::unique_ptr<Cache> cache;
+  String key;
+  String path = output;
+  if (is_cacheable(opts)) {
+    cache.reset(new Cache(opts.cache, opts.limit << 20));
+    key = get_cache_key(toks, get_configuration(opts));
+    if (cache->fetch(key, output)) {
+      if (opts.hits)
+        cache->print_stats(std::cerr);
+      return 0;
+    }
+    path = cache->prepare();
+  }
+
+  // Perform syntactic analysis.
+  Token_stream ts(toks);
+  Parser parse(cxt, ts);
+  {
+    Time_scope span(cxt, "parse");
+    parse();
+  }
+
+  // Elaboration passes.
+  {
+    Time_scope span(cxt, "elaborate declarations");
+    elaborate<Elaborate_declarations>(parse);
+  }
+  {
+    Time_scope span(cxt, "elaborate expressions");
+    elaborate<Elaborate_expressions>(parse);
+  }
+  if (opts.fold) {
+    Time_scope span(cxt, "fold constants");
+    elaborate<Elaborate_constants>(parse);
+  }
+
+  // Write the declarations of the translation unit for the inputs
+  // that import it.
+  if (!opts.iface.empty()) {
+    Time_scope span(cxt, "serialize");
+    Ast_writer write;
+    if (!write(cxt.translation_unit(), opts.iface))
+      return 1;
+  }
+
+  // Elaborate_overloads    overloads(*this);
+  // Elaborate_classes      classes(*this);
+  // Elaborate_expressions  expressions(*this);
+
+
+  // // TODO: Transform abbreviated templates into templates.
+
+  // overloads(tu);    // Analyze overloaded/reopened declarations
+  // classes(tu);      // Complete class definitions
+  // expressions(tu);  // Update expressions
+
+
+  if (opts.emit == "tokens") {
+    for (Token k : toks)
+      std::cout << k << ' ';
+    std::cout << '\n';
+  }
+  else if (opts.emit == "banjo") {
+    std::cout << cxt.translation_unit() << '\n';
+  }
+  else if (opts.emit == "ast") {
+    Time_scope span(cxt, "serialize");
+    Ast_writer write;
+    if (!write(cxt.translation_unit(), output))
+      return 1;
+  }
+  else if (opts.emit == "llvm" && opts.shards > 1) {
+    Time_scope span(cxt, "codegen");
+    Translation_unit const& tu = cxt.translation_unit();
+    if (!ll::emit_parallel(cxt, tu, opts.shards, opts.kind, output, opts.opt, opts.pgo))
+      return 1;
+  }
+  else if (opts.emit == "llvm") {
+    ll::Generator gen(cxt);
+    {
+      Time_scope span(cxt, "codegen");
+      gen(cxt.translation_unit());
+    }
+    {
+      Time_scope span(cxt, "optimize");
+      ll::optimize(*gen.mod, opts.opt, opts.pgo, opts.kind);
+    }
+    Time_scope span(cxt, "emit");
+    if (!ll::emit(*gen.mod, opts.kind, path, opts.opt))
+      return 1;
+    if (cache && !cache->store(key, output))
+      return 1;
+  }
+
+  if (opts.profile)
+    print_profile(cxt);
+  if (cache && opts.hits)
+    cache->print_stats(std::cerr);
+  if (opts.stats)
+    print_stats(cxt);
+  if (opts.report)
+    print_time_report(cxt);
+  if (opts.trace && !write_time_trace(cxt, get_trace_path(output)))
+    return 1;
+  return 0;
+}
+
+
+// Translate the files in a new context.
+int
+translate(Options const& opts, File_seq const& files, String const& output)
+{
+  Symbol_table syms;
+  Context cxt(syms);
+  return translate(cxt, opts, files, output);
+}
+
+
+} // namespace fe
+
+} // namespace banjo
@@ -0,0 +1,29 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#ifndef BANJO_FE_DRIVER_HPP
+#define BANJO_FE_DRIVER_HPP
+
+// The translation pipeline of the compiler driver. This is shared with
+// the benchmark harness, so that its measurements cover every phase
+// that the driver runs.
+
+#include "options.hpp"
+
+
+namespace banjo
+{
+
+namespace fe
+{
+
+int translate(Context&, Options const&, File_seq const&, String const&);
+int translate(Options const&, File_seq const&, String const&);
+
+
+} // namespace fe
+
+} // namespace banjo
+
+
+#endif
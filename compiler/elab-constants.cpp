@@ -0,0 +1,104 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#include "elab-constants.hpp"
+#include "parser.hpp"
+
+#include <banjo/ast.hpp>
+#include <banjo/folding.hpp>
+
+
+namespace banjo
+{
+
+namespace fe
+{
+
+// -------------------------------------------------------------------------- //
+// Statements
+
+void
+Elaborate_constants::on_return_statement(Return_value_stmt& s)
+{
+  s.expr_ = &fold(cxt, s.expression());
+}
+
+
+void
+Elaborate_constants::on_yield_statement(Yield_value_stmt& s)
+{
+  s.expr_ = &fold(cxt, s.expression());
+}
+
+
+void
+Elaborate_constants::on_if_statement(If_then_stmt& s)
+{
+  s.cond_ = &fold(cxt, s.condition());
+}
+
+
+void
+Elaborate_constants::on_if_statement(If_else_stmt& s)
+{
+  s.cond_ = &fold(cxt, s.condition());
+}
+
+
+void
+Elaborate_constants::on_while_statement(While_stmt& s)
+{
+  s.cond_ = &fold(cxt, s.condition());
+}
+
+
+void
+Elaborate_constants::on_expression_statement(Expression_stmt& s)
+{
+  s.expr_ = &fold(cxt, s.expression());
+}
+
+
+// -------------------------------------------------------------------------- //
+// Declarations
+
+// Fold the array bounds in the declared type.
+void
+Elaborate_constants::on_variable_declaration(Variable_decl& d)
+{
+  fold(cxt, d.type());
+}
+
+
+void
+Elaborate_constants::on_variable_initializer(Expression_def& d)
+{
+  d.expr_ = &fold(cxt, d.expression());
+}
+
+
+// Fold the array bounds in the function's type.
+void
+Elaborate_constants::enter_function_declaration(Function_decl& d)
+{
+  fold(cxt, d.type());
+}
+
+
+void
+Elaborate_constants::on_function_body(Expression_def& d)
+{
+  d.expr_ = &fold(cxt, d.expression());
+}
+
+
+void
+Elaborate_constants::on_parameter(Variable_parm& d)
+{
+  fold(cxt, d.type());
+}
+
+
+} // namespace fe
+
+} // namespace banjo
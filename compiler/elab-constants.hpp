@@ -0,0 +1,57 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#ifndef BANJO_FE_ELAB_CONSTANTS_HPP
+#define BANJO_FE_ELAB_CONSTANTS_HPP
+
+#include "elaboration.hpp"
+
+
+namespace banjo
+{
+
+namespace fe
+{
+
+struct Parser;
+struct Context;
+
+
+// Replace constant subexpressions in function bodies, variable 
+// initializers, and array bounds with the literals they compute. This
+// must be run after expressions have been elaborated.
+struct Elaborate_constants : Basic_elaborator
+{
+  using Basic_elaborator::Basic_elaborator;
+
+  // Statements
+  using Basic_elaborator::on_return_statement;
+  using Basic_elaborator::on_yield_statement;
+  void on_return_statement(Return_value_stmt&);
+  void on_yield_statement(Yield_value_stmt&);
+  void on_if_statement(If_then_stmt&);
+  void on_if_statement(If_else_stmt&);
+  void on_while_statement(While_stmt&);
+  void on_expression_statement(Expression_stmt&);
+
+  // Variables
+  void on_variable_declaration(Variable_decl&);
+  using Basic_elaborator::on_variable_initializer;
+  void on_variable_initializer(Expression_def&);
+
+  // Functions
+  void enter_function_declaration(Function_decl&);
+  using Basic_elaborator::on_function_body;
+  void on_function_body(Expression_def&);
+
+  // Parameters
+  void on_parameter(Variable_parm&);
+};
+
+
+} // namespace fe
+
+} // nammespace banjo
+
+
+#endif
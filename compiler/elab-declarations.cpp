@@ -23,7 +23,7 @@ namespace fe
 void
 Elaborate_declarations::on_variable_declaration(Variable_decl& d)
 {
-  d.type_ = &get_type(d.type());
+  d.type_ = &type_of(cxt, d);
   check(d);
 }
 
@@ -33,11 +33,7 @@ Elaborate_declarations::on_variable_declaration(Variable_decl& d)
 void
 Elaborate_declarations::enter_function_declaration(Function_decl& d)
 {
-  Type_list ts;
-  for (Decl& d : d.parameters())
-    ts.push_back(cast<Typed_decl>(d).type());
-  Type& ret = get_type(d.return_type());
-  d.type_ = &cxt.get_function_type(std::move(ts), ret);
+  d.type_ = &type_of(cxt, d);
   check(d);
 
   // Build and declare the function's call operator.
@@ -55,7 +51,7 @@ Elaborate_declarations::enter_function_declaration(Function_decl& d)
 void
 Elaborate_declarations::on_parameter(Variable_parm& d)
 {
-  d.type_ = &get_type(d.type());
+  d.type_ = &type_of(cxt, d);
   check(d);
 }
 
@@ -68,28 +64,6 @@ Elaborate_declarations::start_class_declaration(Class_decl& d)
 }
 
 
-// -------------------------------------------------------------------------- //
-// Types
-
-// Parse the type as needed.
-//
-// TODO: Probably not specific to this function, but a general idea. If t
-// depends on an un-elaborated function or variable definition, then we
-// elaborate that definition as needed. For overloaded functions, any 
-// not-yet-typed declarations are considered non-viable.
-Type&
-Elaborate_declarations::get_type(Type& t)
-{
-  if (Unparsed_type* u = as<Unparsed_type>(&t)) {
-    Save_input_location loc(cxt);
-    Token_stream ts(u->tokens());
-    Parser p(cxt, ts);
-    return p.type();    
-  }
-  return t;
-}
-
-
 // -------------------------------------------------------------------------- //
 // Declaration checking
 
@@ -39,7 +39,6 @@ struct Elaborate_declarations : Basic_elaborator
 
 
   // Utility functions
-  Type& get_type(Type&);
   void check(Decl&);
 };
 
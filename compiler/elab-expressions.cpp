@@ -68,10 +68,11 @@ Elaborate_expressions::on_expression_statement(Expression_stmt& s)
 // Declarations
 
 
+// Parse the variable's initializer, if needed.
 void
-Elaborate_expressions::on_variable_initializer(Expression_def& d)
+Elaborate_expressions::on_variable_declaration(Variable_decl& d)
 {
-  d.expr_ = &get_expr(d.expression());
+  body_of(cxt, d);
 }
 
 
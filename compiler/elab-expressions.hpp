@@ -32,8 +32,7 @@ struct Elaborate_expressions : Basic_elaborator
   void on_while_statement(While_stmt&);
   void on_expression_statement(Expression_stmt&);
 
-  using Basic_elaborator::on_variable_initializer;
-  void on_variable_initializer(Expression_def&);
+  void on_variable_declaration(Variable_decl&);
   
   void on_function_definition(Expression_def&);
 
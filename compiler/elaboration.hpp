@@ -382,6 +382,7 @@ template<typename F>
 inline void
 Elaborator<F>::function_declaration(Function_decl& d)
 {
+  Time_scope span(cxt, "elaborate", d);
   vis.start_function_declaration(d);
   
   // TODO: I wonder if we should have different kinds of scopes for
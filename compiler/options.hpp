@@ -0,0 +1,77 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#ifndef BANJO_FE_OPTIONS_HPP
+#define BANJO_FE_OPTIONS_HPP
+
+// The options of the compiler, as given on the command line. These are
+// shared by the driver and the compile server.
+
+#include "context.hpp"
+
+#include <codegen/emitter.hpp>
+#include <codegen/optimizer.hpp>
+
+#include <lingo/file.hpp>
+
+#include <cstdint>
+#include <vector>
+
+
+namespace banjo
+{
+
+namespace fe
+{
+
+using File_seq = std::vector<lingo::File*>;
+
+
+struct Options
+{
+  Options() = default;
+  Options(Options const&) = delete;
+  Options& operator=(Options const&) = delete;
+  ~Options();
+
+  String              emit    = "llvm";
+  ll::Output_kind     kind    = ll::ir_output;
+  String              output  = {};
+  int                 opt     = 0;
+  ll::Profile_options pgo     = {};
+  int                 shards  = 1;
+  bool                link    = false;
+  bool                fold    = false;
+  bool                profile = false;
+  bool                report  = false;
+  bool                trace   = false;
+  bool                stats   = false;
+  String              cache   = {};
+  std::uintmax_t      limit   = 256;
+  bool                hits    = false;
+  bool                server  = false;
+  Diagnostic_format   diags   = text_format;
+  Evaluation_limits   limits  = {};
+  Layout_options      layout  = {};
+  File_seq            inputs  = {};
+  std::vector<String> paths   = {};
+  std::vector<String> imports = {};
+  String              iface   = {};
+  String              build   = {};
+};
+
+
+inline
+Options::~Options()
+{
+  for (lingo::File* f : inputs)
+    delete f;
+}
+
+
+} // namespace fe
+
+} // namespace banjo
+
+
+#endif
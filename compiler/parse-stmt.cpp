@@ -5,6 +5,8 @@
 
 #include <banjo/ast.hpp>
 
+#include <limits>
+
 
 namespace banjo
 {
@@ -187,7 +189,7 @@ Parser::if_statement()
 // Parse a while statement.
 //
 //    while-statement:
-//      'while' '(' condition ')' statement
+//      'while' [loop-hints] '(' condition ')' statement
 //
 // TODO: Allow a declaration in the condition?
 Stmt&
@@ -196,11 +198,69 @@ Parser::while_statement()
   Match_token_pred end_cond(*this, tk::rparen_tok);
   
   require(tk::while_tok);
+  Loop_hints hints;
+  if (next_token_is(tk::lbracket_tok))
+    hints = loop_hints();
   match(tk::lparen_tok);
   Expr& cond = unparsed_expression(end_cond);
   match(tk::rparen_tok);
   Stmt& body = statement();
-  return on_while_statement(cond, body);
+  return on_while_statement(cond, body, hints);
+}
+
+
+// Parse a list of loop hints.
+//
+//    loop-hints:
+//      '[' loop-hint-list ']'
+//
+//    loop-hint-list:
+//      loop-hint
+//      loop-hint-list ',' loop-hint
+//
+//    loop-hint:
+//      'vectorize' '=' integer-literal
+//      'unroll' '=' integer-literal
+//
+// Note that 'vectorize' and 'unroll' are contextual keywords. The
+// value of a hint must be a positive int.
+Loop_hints
+Parser::loop_hints()
+{
+  Loop_hints hints;
+  match(tk::lbracket_tok);
+  do {
+    Token id = match(tk::identifier_tok);
+    int* hint;
+    if (id.spelling() == "vectorize") {
+      hint = &hints.vectorize;
+    } else if (id.spelling() == "unroll") {
+      hint = &hints.unroll;
+    } else {
+      error(cxt, "unknown loop hint '{}'", id);
+      throw Syntax_error();
+    }
+    match(tk::eq_tok);
+
+    // Integer literals are sequences of decimal digits.
+    Token tok = match(tk::integer_tok);
+    int n = 0;
+    for (char c : tok.spelling()) {
+      int d = c - '0';
+      if (n > (std::numeric_limits<int>::max() - d) / 10) {
+        error(cxt, "loop hint '{}' is too large", id);
+        throw Syntax_error();
+      }
+      n = n * 10 + d;
+    }
+    if (n == 0) {
+      error(cxt, "loop hint '{}' must be positive", id);
+      throw Syntax_error();
+    }
+    *hint = n;
+  } while (match_if(tk::comma_tok));
+  match(tk::rbracket_tok);
+  return hints;
 }
 
 
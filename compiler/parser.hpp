@@ -132,6 +132,7 @@ struct Parser
   Stmt& yield_statement();
   Stmt& if_statement();
   Stmt& while_statement();
+  Loop_hints loop_hints();
   Stmt& for_statement();
   Stmt& break_statement();
   Stmt& continue_statement();
@@ -286,7 +287,7 @@ struct Parser
   Stmt& on_yield_statement(Token, Expr&);
   Stmt& on_if_statement(Expr&, Stmt&);
   Stmt& on_if_statement(Expr&, Stmt&, Stmt&);
-  Stmt& on_while_statement(Expr&, Stmt&);
+  Stmt& on_while_statement(Expr&, Stmt&, Loop_hints const&);
   Stmt& on_break_statement();
   Stmt& on_continue_statement();
   Stmt& on_declaration_statement(Decl&);
@@ -6,13 +6,89 @@
 #include <banjo/ast.hpp>
 #include <banjo/debugging.hpp>
 
+#include <cstring>
 #include <iterator>
 #include <iostream>
+#include <sstream>
 
 
 namespace banjo
 {
 
+// -------------------------------------------------------------------------- //
+// Output
+
+// Output is written to the stream when the buffer reaches this size.
+// The buffer is not reserved in advance, since most printers write
+// only a few characters.
+constexpr std::size_t flush_size = 1 << 16;
+
+
+// Spaces for indentation. Deeper indentation is written in pieces.
+static char const indents[] = "                                                                ";
+constexpr std::size_t indents_size = sizeof(indents) - 1;
+
+
+Printer::Printer(std::ostream& os)
+  : os(os), indent(0)
+{ }
+
+
+Printer::~Printer()
+{
+  flush();
+}
+
+
+void
+Printer::write(char c)
+{
+  buf += c;
+  if (buf.size() >= flush_size)
+    flush();
+}
+
+
+void
+Printer::write(char const* str, std::size_t n)
+{
+  buf.append(str, n);
+  if (buf.size() >= flush_size)
+    flush();
+}
+
+
+void
+Printer::write(String const& str)
+{
+  write(str.data(), str.size());
+}
+
+
+// Write the buffered output to the stream.
+void
+Printer::flush()
+{
+  os.write(buf.data(), buf.size());
+  buf.clear();
+}
+
+
+// Returns an empty stream for formatting numbers with the flags of the
+// output stream. Most printers write no numbers, so the stream is only
+// created when first needed.
+std::ostringstream&
+Printer::numbers()
+{
+  if (!num) {
+    num.reset(new std::ostringstream);
+    num->copyfmt(os);
+  }
+  num->str({});
+  return *num;
+}
+
+
 // -------------------------------------------------------------------------- //
 // Lexical items
 
@@ -20,7 +96,7 @@ namespace banjo
 void
 Printer::space()
 {
-  os << ' ';
+  write(' ');
 }
 
 
@@ -28,7 +104,13 @@ Printer::space()
 void
 Printer::newline()
 {
-  os << '\n' << std::string(2 * indent, ' ');
+  write('\n');
+  std::size_t n = indent > 0 ? 2 * indent : 0;
+  while (n > indents_size) {
+    write(indents, indents_size);
+    n -= indents_size;
+  }
+  write(indents, n);
 }
 
 
@@ -54,7 +136,7 @@ Printer::newline_and_undent()
 void
 Printer::token(Token k)
 {
-  os << k.spelling();
+  write(k.spelling());
 }
 
 
@@ -62,7 +144,7 @@ Printer::token(Token k)
 void
 Printer::token(Symbol const& sym)
 {
-  os << sym.spelling();
+  write(sym.spelling());
 }
 
 
@@ -70,7 +152,7 @@ Printer::token(Symbol const& sym)
 void
 Printer::token(char c)
 {
-  os << c;
+  write(c);
 }
 
 
@@ -78,7 +160,7 @@ Printer::token(char c)
 void
 Printer::token(char const* str)
 {
-  os << str;
+  write(str, std::strlen(str));
 }
 
 
@@ -86,7 +168,7 @@ Printer::token(char const* str)
 void
 Printer::token(String const& str)
 {
-  os << str;
+  write(str);
 }
 
 
@@ -94,14 +176,18 @@ Printer::token(String const& str)
 void
 Printer::token(int n)
 {
-  os << n;
+  std::ostringstream& ss = numbers();
+  ss << n;
+  write(ss.str());
 }
 
 
 void
 Printer::token(Integer const& n)
 {
-  os << n;
+  std::ostringstream& ss = numbers();
+  ss << n;
+  write(ss.str());
 }
 
 
@@ -1183,6 +1269,26 @@ Printer::while_statement(While_stmt const& s)
 {
   token("while");
   space();
+  Loop_hints const& h = s.hints();
+  if (h.vectorize || h.unroll) {
+    token('[');
+    if (h.vectorize) {
+      token("vectorize");
+      token('=');
+      token(h.vectorize);
+    }
+    if (h.vectorize && h.unroll) {
+      token(',');
+      space();
+    }
+    if (h.unroll) {
+      token("unroll");
+      token('=');
+      token(h.unroll);
+    }
+    token(']');
+    space();
+  }
   token('(');
   expression(s.condition());
   token(')');
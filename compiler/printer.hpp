@@ -11,11 +11,15 @@
 //
 // NOTE: When forking the banjo grammar, be sure to update this printer
 // to the most recent version.
+//
+// Output is formatted into a buffer that is written to the stream in
+// large blocks, and when the printer is destroyed.
 
 #include <banjo/token.hpp>
 #include <banjo/language.hpp>
 
 #include <iosfwd>
+#include <memory>
 
 
 namespace banjo
@@ -23,9 +27,12 @@ namespace banjo
 
 struct Printer
 {
-  Printer(std::ostream& os)
-    : os(os), indent(0)
-  { }
+  Printer(std::ostream&);
+  ~Printer();
+
+  // Non-copyable
+  Printer(Printer const&) = delete;
+  Printer& operator=(Printer const&) = delete;
 
   void operator()(Name const& n) { id(n); }
   void operator()(Type const& t) { type(t); }
@@ -34,6 +41,13 @@ struct Printer
   void operator()(Decl const& d) { declaration(d); }
   void operator()(Cons const& c) { constraint(c); }
 
+  // Output
+  void write(char);
+  void write(char const*, std::size_t);
+  void write(String const&);
+  void flush();
+  std::ostringstream& numbers();
+
   // Lexical terms.
   void space();
   void newline();
@@ -237,8 +251,10 @@ struct Printer
   void constraint(Disjunction_cons const&);
   void grouped_constraint(Cons const&);
 
-  std::ostream& os;     // Output stream
-  int           indent; // The current indentation
+  std::ostream&      os;     // Output stream
+  int                indent; // The current indentation
+  String             buf;    // Formatted output not yet written
+  std::unique_ptr<std::ostringstream> num; // Formats numbers
 };
 
 
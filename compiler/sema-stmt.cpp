@@ -81,9 +81,9 @@ Parser::on_if_statement(Expr& e, Stmt& s1, Stmt& s2)
 
 
 Stmt&
-Parser::on_while_statement(Expr& e, Stmt& s)
+Parser::on_while_statement(Expr& e, Stmt& s, Loop_hints const& h)
 {
-  return cxt.make_while_statement(e, s);
+  return cxt.make_while_statement(e, s, h);
 }
 
 
@@ -0,0 +1,363 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#include "server.hpp"
+#include "cache.hpp"
+#include "lexer.hpp"
+
+#include "elab-declarations.hpp"
+#include "elab-expressions.hpp"
+#include "elab-constants.hpp"
+
+#include <banjo/ast.hpp>
+
+#include <codegen/generator.hpp>
+#include <codegen/optimizer.hpp>
+
+#include <lingo/file.hpp>
+#include <lingo/error.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+
+namespace banjo
+{
+
+namespace fe
+{
+
+Server::Server(Options const& o)
+  : opts(o), changed(0), reused(0)
+{
+  reset();
+}
+
+
+// Serve requests until the input is exhausted or the server is asked
+// to quit.
+int
+Server::operator()()
+{
+  String line;
+  while (std::getline(std::cin, line)) {
+    std::stringstream ss(line);
+    String req;
+    ss >> req;
+    if (req == "compile") {
+      String output;
+      std::vector<String> paths;
+      ss >> output;
+      for (String p; ss >> p; )
+        paths.push_back(p);
+      if (output.empty() || output == "-" || paths.empty()) {
+        lingo::error("expected an output file and inputs after 'compile'");
+        std::cout << "error\n";
+      } else if (compile(paths, output)) {
+        std::cout << "ok " << changed << ' ' << reused << '\n';
+      } else {
+        std::cout << "error\n";
+      }
+    } else if (req == "reset") {
+      reset();
+      std::cout << "ok\n";
+    } else if (req == "quit") {
+      break;
+    } else if (!req.empty()) {
+      lingo::error("unknown request '{}'", req);
+      std::cout << "error\n";
+    }
+    std::cout.flush();
+  }
+  return 0;
+}
+
+
+// Discard all translation state, including the context and its
+// builtins. The new context is configured by the options.
+void
+Server::reset()
+{
+  chunks.clear();
+  cxt.reset();
+  syms.reset(new Symbol_table());
+  cxt.reset(new Context(*syms));
+  cxt->evaluation_limits() = opts.limits;
+  cxt->layout_options() = opts.layout;
+  cxt->diagnostics().format = opts.diags;
+  cxt->diagnostics().deferred = opts.diags == json_format;
+}
+
+
+// Returns true if the sequences have the same kinds and spellings
+// of tokens.
+static bool
+same_tokens(lingo::Token_seq const& a, lingo::Token_seq const& b)
+{
+  auto same = [](Token const& x, Token const& y) {
+    return x.kind() == y.kind() && x.spelling() == y.spelling();
+  };
+  return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), same);
+}
+
+
+// Returns true if the token can start a top-level declaration.
+static bool
+starts_declaration(Token const& k)
+{
+  switch (k.kind()) {
+    case Token_kind::var_tok:
+    case Token_kind::const_tok:
+    case Token_kind::def_tok:
+    case Token_kind::class_tok:
+    case Token_kind::super_tok:
+    case Token_kind::template_tok:
+    case Token_kind::static_tok:
+    case Token_kind::dynamic_tok:
+    case Token_kind::inline_tok:
+    case Token_kind::explicit_tok:
+    case Token_kind::implicit_tok:
+    case Token_kind::virtual_tok:
+    case Token_kind::abstract_tok:
+    case Token_kind::public_tok:
+    case Token_kind::private_tok:
+    case Token_kind::protected_tok:
+      return true;
+    default:
+      return false;
+  }
+}
+
+
+// Split the tokens of a file into top-level declarations. A declaration
+// ends with a semicolon outside of braces, or with a closing brace that
+// is followed by the start of another declaration.
+Chunk_list
+Server::split(lingo::Token_seq&& toks)
+{
+  Chunk_list cs;
+  std::unique_ptr<Chunk> c(new Chunk());
+  int depth = 0;
+  for (auto i = toks.begin(); i != toks.end(); ++i) {
+    Token const& k = *i;
+    int kind = k.kind();
+    c->toks.push_back(k);
+    if (kind == Token_kind::identifier_tok) {
+      if (c->name.empty())
+        c->name = k.spelling();
+      else
+        c->uses.insert(k.spelling());
+    }
+    else if (kind == Token_kind::lbrace_tok) {
+      ++depth;
+    }
+    else if (kind == Token_kind::rbrace_tok) {
+      --depth;
+    }
+
+    // Determine if the declaration is complete.
+    bool end = false;
+    if (depth == 0 && kind == Token_kind::semicolon_tok) {
+      end = true;
+    } else if (depth == 0 && kind == Token_kind::rbrace_tok) {
+      auto next = std::next(i);
+      end = next == toks.end() || starts_declaration(*next);
+    }
+    if (end) {
+      c->hash = hash_tokens(c->toks, {});
+      cs.push_back(std::move(c));
+      c.reset(new Chunk());
+    }
+  }
+
+  // Keep any trailing tokens so that they are diagnosed.
+  if (!c->toks.empty()) {
+    c->hash = hash_tokens(c->toks, {});
+    cs.push_back(std::move(c));
+  }
+  return cs;
+}
+
+
+// Parse the statements of the chunk, replacing any previous parse.
+void
+Server::parse(Chunk& c)
+{
+  c.stmts = {};
+  c.stream.reset(new Token_stream(c.toks));
+  c.parser.reset(new Parser(*cxt, *c.stream));
+  c.stmts = c.parser->toplevel_statement_seq();
+}
+
+
+// Remove the declarations of the chunk from the global scope, and
+// discard the semantic information computed from them.
+void
+Server::unbind(Chunk& c)
+{
+  Decl& tu = cxt->builtins().translation_unit();
+  Scope& scope = cxt->saved_scope(tu);
+  for (Stmt& s : c.stmts) {
+    if (Declaration_stmt* d = as<Declaration_stmt>(&s)) {
+      scope.unbind(d->declaration());
+      cxt->queries().invalidate(d->declaration());
+    }
+  }
+}
+
+
+// Translate the given files to the output. Declarations are matched
+// with those of the previous request by their tokens. Unmatched
+// declarations, and declarations that use their names, are parsed and
+// elaborated again. On failure, all state is discarded so that the
+// next request starts from scratch.
+bool
+Server::compile(std::vector<String> const& paths, String const& output)
+{
+  int errs = lingo::error_count();
+
+  // Lex and split each input.
+  Chunk_list next;
+  for (String const& p : paths) {
+    lingo::File f(p.c_str());
+    Character_stream cs(f);
+    Token_stream ts;
+    Lexer lex(*cxt, cs, ts);
+    lex();
+    if (lingo::error_count() != errs) {
+      reset();
+      return false;
+    }
+    for (auto& c : split(std::move(ts.buf_)))
+      next.push_back(std::move(c));
+  }
+
+  // Reuse previous declarations with the same tokens. Declarations
+  // are found by hash, but only reused when their tokens are equal.
+  std::unordered_map<std::size_t, std::vector<std::size_t>> prev;
+  for (std::size_t i = 0; i < chunks.size(); ++i)
+    prev[chunks[i]->hash].push_back(i);
+  std::vector<bool> fresh(next.size(), true);
+  for (std::size_t i = 0; i < next.size(); ++i) {
+    std::vector<std::size_t>& v = prev[next[i]->hash];
+    auto same = [&](std::size_t j) {
+      return same_tokens(chunks[j]->toks, next[i]->toks);
+    };
+    auto j = std::find_if(v.begin(), v.end(), same);
+    if (j != v.end()) {
+      next[i] = std::move(chunks[*j]);
+      fresh[i] = false;
+      v.erase(j);
+    }
+  }
+
+  // Remove declarations that no longer exist, and collect the names
+  // of all declarations that changed.
+  std::unordered_set<String> names;
+  for (auto& c : chunks) {
+    if (c) {
+      names.insert(c->name);
+      unbind(*c);
+    }
+  }
+  chunks = std::move(next);
+  for (std::size_t i = 0; i < chunks.size(); ++i) {
+    if (fresh[i])
+      names.insert(chunks[i]->name);
+  }
+
+  // Declarations that use changed names must be elaborated again.
+  // This repeats until no more declarations change.
+  bool grew = true;
+  while (grew) {
+    grew = false;
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+      if (fresh[i])
+        continue;
+      Chunk& c = *chunks[i];
+      auto used = [&](String const& s) { return names.count(s) != 0; };
+      if (std::any_of(c.uses.begin(), c.uses.end(), used)) {
+        fresh[i] = true;
+        names.insert(c.name);
+        unbind(c);
+        grew = true;
+      }
+    }
+  }
+
+  changed = std::count(fresh.begin(), fresh.end(), true);
+  reused = chunks.size() - changed;
+
+  // Parse and elaborate the changed declarations. Every declaration is
+  // elaborated before any definition.
+  Translation_unit& tu = cast<Translation_unit>(cxt->builtins().translation_unit());
+  try {
+    Enter_scope scope(*cxt, cxt->saved_scope(tu));
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+      if (fresh[i])
+        parse(*chunks[i]);
+    }
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+      if (fresh[i]) {
+        Chunk& c = *chunks[i];
+        Elaborator<Elaborate_declarations> elab(*cxt, Elaborate_declarations(*c.parser));
+        for (Stmt& s : c.stmts)
+          elab.statement(s);
+      }
+    }
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+      if (fresh[i]) {
+        Chunk& c = *chunks[i];
+        Elaborator<Elaborate_expressions> elab(*cxt, Elaborate_expressions(*c.parser));
+        for (Stmt& s : c.stmts)
+          elab.statement(s);
+      }
+    }
+    for (std::size_t i = 0; opts.fold && i < chunks.size(); ++i) {
+      if (fresh[i]) {
+        Chunk& c = *chunks[i];
+        Elaborator<Elaborate_constants> elab(*cxt, Elaborate_constants(*c.parser));
+        for (Stmt& s : c.stmts)
+          elab.statement(s);
+      }
+    }
+  } catch (Translation_error&) {
+    reset();
+    return false;
+  }
+  if (lingo::error_count() != errs) {
+    reset();
+    return false;
+  }
+
+  // Rebuild the translation unit in declaration order.
+  Stmt_list ss;
+  for (auto& c : chunks) {
+    for (Stmt& s : c->stmts)
+      ss.push_back(s);
+  }
+  tu.statements() = std::move(ss);
+
+  // Generate code for the translation unit. Constants may be evaluated
+  // during code generation, so errors are handled as above.
+  ll::Generator gen(*cxt);
+  bool ok;
+  try {
+    gen(tu);
+    ll::optimize(*gen.mod, opts.opt, opts.pgo, opts.kind);
+    ok = ll::emit(*gen.mod, opts.kind, output, opts.opt);
+  } catch (Translation_error&) {
+    delete gen.mod;
+    reset();
+    return false;
+  }
+  delete gen.mod;
+  cxt->diagnostics().flush(std::cerr);
+  return ok;
+}
+
+
+} // namespace fe
+
+} // namespace banjo
@@ -0,0 +1,84 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#ifndef BANJO_SERVER_HPP
+#define BANJO_SERVER_HPP
+
+// A persistent compile server. The server holds a translation context
+// in memory across requests. When inputs change, only the top-level
+// declarations whose tokens changed, or that refer to the names of
+// changed declarations, are parsed and elaborated again.
+//
+// Requests are read one per line from stdin, and a reply is written
+// for each on stdout. Each request is translated with the options given
+// to the server on the command line.
+//
+//    compile <output> <file>...  -- translate the files to the output
+//    reset                       -- discard all translation state
+//    quit                        -- stop the server
+//
+// The reply to a compile request is "ok <changed> <reused>", giving
+// the number of declarations elaborated and reused, or "error".
+
+#include "context.hpp"
+#include "options.hpp"
+#include "parser.hpp"
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+
+namespace banjo
+{
+
+namespace fe
+{
+
+// A top-level declaration of an input file. The tokens of the
+// declaration are kept for parsing and elaboration, and the names
+// used by the declaration are kept to determine its dependencies.
+struct Chunk
+{
+  std::size_t                     hash;   // A hash of the tokens
+  String                          name;   // The declared name
+  std::unordered_set<String>      uses;   // Identifiers used
+  lingo::Token_seq                toks;   // The tokens of the declaration
+  std::unique_ptr<Token_stream>   stream; // The stream being parsed
+  std::unique_ptr<Parser>         parser; // The parser of the tokens
+  Stmt_list                       stmts;  // The parsed statements
+};
+
+
+using Chunk_list = std::vector<std::unique_ptr<Chunk>>;
+
+
+struct Server
+{
+  Server(Options const&);
+
+  int operator()();
+
+  bool compile(std::vector<String> const&, String const&);
+  void reset();
+
+  Chunk_list split(lingo::Token_seq&&);
+  void parse(Chunk&);
+  void unbind(Chunk&);
+
+  Options const& opts;     // The options of each translation
+  std::size_t    changed;  // Declarations elaborated by the last request
+  std::size_t    reused;   // Declarations reused by the last request
+
+  std::unique_ptr<Symbol_table> syms;
+  std::unique_ptr<Context>      cxt;
+  Chunk_list                    chunks;
+};
+
+
+} // namespace fe
+
+} // namespace banjo
+
+
+#endif
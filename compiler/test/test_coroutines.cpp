@@ -0,0 +1,55 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#include "translate.hpp"
+
+#include <codegen/generator.hpp>
+#include <codegen/optimizer.hpp>
+
+#include <llvm/IR/Module.h>
+
+
+// Returns true if the module calls the named intrinsic.
+bool
+calls_intrinsic(llvm::Module& mod, char const* name)
+{
+  llvm::Function* f = mod.getFunction(name);
+  return f && !f->use_empty();
+}
+
+
+// Coroutines are split into their ramp, resume, and destroy functions,
+// even when not optimizing, and no coroutine intrinsics remain.
+void
+test_split(char const* dir, int level)
+{
+  Symbol_table syms;
+  fe::Context cxt(syms);
+  bool ok = translate(cxt, read_program(dir, "coroutine-1.banjo"));
+  assert(ok);
+
+  ll::Generator gen(cxt);
+  llvm::Module* mod = gen(cxt.translation_unit());
+  ll::optimize(*mod, level);
+
+  for (char const* name : {"count", "twice", "pause"}) {
+    String f = name;
+    assert(mod->getFunction(f));
+    assert(mod->getFunction(f + ".resume"));
+    assert(mod->getFunction(f + ".destroy"));
+  }
+  assert(!calls_intrinsic(*mod, "llvm.coro.begin"));
+  assert(!calls_intrinsic(*mod, "llvm.coro.suspend"));
+  assert(!calls_intrinsic(*mod, "llvm.coro.free"));
+  delete mod;
+}
+
+
+int
+main(int argc, char* argv[])
+{
+  assert(argc == 2);
+  test_split(argv[1], 0);
+  test_split(argv[1], 1);
+  test_split(argv[1], 2);
+}
@@ -0,0 +1,115 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#include "translate.hpp"
+
+#include <banjo/folding.hpp>
+
+#include <cassert>
+#include <cstdint>
+
+
+// Returns the expression without its initialization or conversions.
+Expr&
+unwrap(Expr& e)
+{
+  if (Copy_init* i = as<Copy_init>(&e))
+    return unwrap(i->expression());
+  if (Conv* c = as<Conv>(&e))
+    return unwrap(c->source());
+  return e;
+}
+
+
+// Returns the initializer of the named variable.
+Expr&
+initializer(Context& cxt, char const* name)
+{
+  Variable_decl& d = cast<Variable_decl>(*find_declaration(cxt, name));
+  return unwrap(cast<Expression_def>(d.initializer()).expression());
+}
+
+
+// Returns the operand of the first statement of the named function,
+// which must be a return statement.
+Expr&
+returned(Context& cxt, char const* name)
+{
+  Function_decl& f = cast<Function_decl>(*find_declaration(cxt, name));
+  Function_def& def = cast<Function_def>(f.definition());
+  Compound_stmt& body = cast<Compound_stmt>(def.statement());
+  Stmt& s = *body.statements().begin();
+  return unwrap(cast<Return_value_stmt>(s).expression());
+}
+
+
+// Returns true if e is the integer literal n.
+bool
+is_integer(Expr& e, std::int64_t n)
+{
+  Integer_expr* i = as<Integer_expr>(&e);
+  return i && i->value().impl().getSExtValue() == n;
+}
+
+
+char const* program =
+  "var x : int = 3 + 4 * 2;\n"
+  "var y : int = 2147483647 + 1;\n"
+  "def f(n : int) -> int { return n + 2 * 3; }\n";
+
+
+// Returns the number of warnings issued in the context.
+int
+count_warnings(Context& cxt)
+{
+  int n = 0;
+  for (Diagnostic_record const& r : cxt.diagnostics().records)
+    if (r.level == warning_level)
+      ++n;
+  return n;
+}
+
+
+// Constant subexpressions are replaced by the literals they compute.
+// Expressions whose evaluation fails are left unchanged, and a warning
+// is issued; translation still succeeds.
+void
+test_fold()
+{
+  Symbol_table syms;
+  fe::Context cxt(syms);
+  cxt.diagnostics().deferred = true;
+  bool ok = translate(cxt, program, true);
+  assert(ok);
+
+  assert(is_integer(initializer(cxt, "x"), 11));
+  assert(is<Add_expr>(&initializer(cxt, "y")));
+  assert(count_warnings(cxt) == 1);
+
+  Add_expr* e = as<Add_expr>(&returned(cxt, "f"));
+  assert(e);
+  assert(!is_literal(e->left()));
+  assert(is_integer(unwrap(e->right()), 6));
+}
+
+
+// Nothing is folded unless it is requested.
+void
+test_no_fold()
+{
+  Symbol_table syms;
+  fe::Context cxt(syms);
+  cxt.diagnostics().deferred = true;
+  bool ok = translate(cxt, program);
+  assert(ok);
+  assert(is<Add_expr>(&initializer(cxt, "x")));
+  assert(count_warnings(cxt) == 0);
+}
+
+
+int
+main()
+{
+  test_fold();
+  test_no_fold();
+}
@@ -0,0 +1,57 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#include "translate.hpp"
+
+#include <codegen/generator.hpp>
+
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Module.h>
+
+
+// Returns the constant initializer of the named global.
+llvm::ConstantInt*
+get_initializer(llvm::Module& mod, char const* name)
+{
+  llvm::GlobalVariable* var = mod.getNamedGlobal(name);
+  assert(var && var->hasInitializer());
+  return llvm::dyn_cast<llvm::ConstantInt>(var->getInitializer());
+}
+
+
+// Globals initialized by constant expressions, including standard
+// conversions of constant expressions, are emitted with their values,
+// and are not initialized at run time.
+void
+test_constant()
+{
+  Symbol_table syms;
+  fe::Context cxt(syms);
+  bool ok = translate(cxt,
+    "var a : int = 0 + 2 * 4;\n"
+    "var b : bool = !0;\n"
+    "var c : bool = 1 && 2;\n"
+  );
+  assert(ok);
+
+  ll::Generator gen(cxt);
+  llvm::Module* mod = gen(cxt.translation_unit());
+
+  llvm::ConstantInt* a = get_initializer(*mod, "a");
+  assert(a && a->getSExtValue() == 8);
+  llvm::ConstantInt* b = get_initializer(*mod, "b");
+  assert(b && b->isZero());
+  llvm::ConstantInt* c = get_initializer(*mod, "c");
+  assert(c && c->isOne());
+
+  assert(!mod->getFunction("__banjo_init"));
+  assert(!mod->getNamedGlobal("llvm.global_ctors"));
+  delete mod;
+}
+
+
+int
+main(int argc, char* argv[])
+{
+  test_constant();
+}
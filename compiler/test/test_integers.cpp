@@ -0,0 +1,124 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#include "translate.hpp"
+
+#include <banjo/evaluation.hpp>
+
+#include <cassert>
+#include <cstdint>
+
+
+// Returns the wide integer 2^n + k with the given precision.
+llvm::APSInt
+power(int prec, int n, std::int64_t k, bool sign = true)
+{
+  llvm::APInt v = llvm::APInt(prec, 1).shl(n) + llvm::APInt(prec, k, true);
+  return llvm::APSInt(v, !sign);
+}
+
+
+// Integers of 64 bits or less never promote. Signed overflow is an
+// error, and unsigned arithmetic wraps.
+void
+test_narrow()
+{
+  Integer_spec i32 {32, true};
+  assert(integer_add(i32, Value(2147483646), Value(1)).get_integer() == 2147483647);
+  assert(integer_add(i32, Value(2147483647), Value(1)).is_error());
+  assert(integer_neg(i32, Value(-2147483647 - 1)).is_error());
+
+  Integer_spec u8 {8, false};
+  assert(integer_add(u8, Value(255), Value(1)).get_integer() == 0);
+  assert(integer_sub(u8, Value(0), Value(1)).get_integer() == 255);
+
+  // Unsigned 64-bit values are stored as their bit pattern.
+  Integer_spec u64 {64, false};
+  Value max = make_integer(u64, llvm::APSInt::getMaxValue(64, true));
+  assert(max.is_integer());
+  assert(integer_add(u64, max, Value(1)).get_integer() == 0);
+  assert(integer_compare(u64, max, Value(1)) > 0);
+
+  Integer_spec i64 {64, true};
+  assert(integer_add(i64, Value(INT64_MAX), Value(1)).is_error());
+  assert(integer_div(i64, Value(INT64_MIN), Value(-1)).is_error());
+}
+
+
+// Wider integers stay inline while their value fits in 64 bits, and
+// are promoted when it does not.
+void
+test_wide()
+{
+  Integer_spec i128 {128, true};
+  Value v = integer_mul(i128, Value(INT64_MAX), Value(4));
+  assert(v.is_wide());
+  assert(get_wide_integer(i128, v) == power(128, 65, -4));
+
+  Value w = integer_sub(i128, v, v);
+  assert(w.is_integer() && w.get_integer() == 0);
+
+  Value x = integer_div(i128, Value(INT64_MIN), Value(-1));
+  assert(x.is_wide());
+  assert(get_wide_integer(i128, x) == power(128, 63, 0));
+  assert(integer_compare(i128, x, Value(INT64_MAX)) > 0);
+
+  Value max = make_integer(i128, llvm::APSInt::getMaxValue(128, false));
+  assert(integer_add(i128, max, Value(1)).is_error());
+
+  // Unsigned results wrap at the precision of the type.
+  Integer_spec u128 {128, false};
+  Value y = integer_sub(u128, Value(0), Value(1));
+  assert(y.is_wide());
+  assert(get_wide_integer(u128, y) == llvm::APSInt::getMaxValue(128, true));
+  Value z = integer_add(u128, y, Value(1));
+  assert(z.is_integer() && z.get_integer() == 0);
+}
+
+
+// Division by zero is an error for every precision.
+void
+test_division()
+{
+  Integer_spec i32 {32, true};
+  Integer_spec u128 {128, false};
+  assert(integer_div(i32, Value(1), Value(0)).is_error());
+  assert(integer_rem(i32, Value(1), Value(0)).is_error());
+  assert(integer_div(u128, Value(1), Value(0)).is_error());
+}
+
+
+// The evaluator computes in the precision of the type of the expression,
+// and diagnoses overflow.
+void
+test_evaluate()
+{
+  Symbol_table syms;
+  fe::Context cxt(syms);
+  Type& t = cxt.get_integer_type(true, 128);
+  Expr& a = cxt.get_integer(t, Integer(power(128, 100, 0)));
+  Expr& b = cxt.get_integer(t, Integer(power(128, 100, 0)));
+  Value v = evaluate(cxt, cxt.make_add(t, a, b));
+  assert(v.is_wide());
+  assert(get_wide_integer({128, true}, v) == power(128, 101, 0));
+
+  Expr& c = cxt.get_integer(t, Integer(power(128, 126, 0)));
+  Expr& d = cxt.get_integer(t, Integer(power(128, 126, 0)));
+  bool thrown = false;
+  try {
+    evaluate(cxt, cxt.make_add(t, c, d));
+  } catch (Evaluation_error&) {
+    thrown = true;
+  }
+  assert(thrown);
+}
+
+
+int
+main()
+{
+  test_narrow();
+  test_wide();
+  test_division();
+  test_evaluate();
+}
@@ -0,0 +1,112 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#include "translate.hpp"
+
+#include <banjo/evaluation.hpp>
+
+#include <cassert>
+
+
+// Returns a balanced sum of integers with the given depth. Evaluating
+// the sum takes 2^(depth + 1) - 1 steps, nested depth + 1 deep.
+Expr&
+make_sum(Context& cxt, int depth, int n = 0)
+{
+  Type& t = cxt.get_int_type();
+  if (depth == 0)
+    return cxt.get_integer(t, n);
+  Expr& l = make_sum(cxt, depth - 1, 2 * n);
+  Expr& r = make_sum(cxt, depth - 1, 2 * n + 1);
+  return cxt.make_add(t, l, r);
+}
+
+
+// Returns true if the evaluation of e fails, and the failure is
+// diagnosed.
+bool
+fails(Context& cxt, Expr const& e)
+{
+  int errs = error_count();
+  try {
+    evaluate(cxt, e);
+  } catch (Evaluation_error&) {
+    return error_count() > errs;
+  }
+  return false;
+}
+
+
+// Evaluation fails when it takes more steps than the limit.
+void
+test_steps()
+{
+  Symbol_table syms;
+  fe::Context cxt(syms);
+  Expr& e = make_sum(cxt, 4);
+  cxt.evaluation_limits().steps = 31;
+  assert(evaluate(cxt, e).get_integer() == 120);
+  cxt.evaluation_limits().steps = 30;
+  assert(fails(cxt, e));
+}
+
+
+// Evaluation fails when it is nested more deeply than the limit.
+void
+test_depth()
+{
+  Symbol_table syms;
+  fe::Context cxt(syms);
+  Expr& e = make_sum(cxt, 4);
+  cxt.evaluation_limits().depth = 5;
+  assert(evaluate(cxt, e).get_integer() == 120);
+  cxt.evaluation_limits().depth = 4;
+  assert(fails(cxt, e));
+
+  // Each evaluation starts from the top.
+  cxt.evaluation_limits().depth = 5;
+  assert(evaluate(cxt, e).get_integer() == 120);
+}
+
+
+// A limit of 0 is unbounded.
+void
+test_unbounded()
+{
+  Symbol_table syms;
+  fe::Context cxt(syms);
+  Expr& e = make_sum(cxt, 12);
+  cxt.evaluation_limits() = {0, 0};
+  assert(evaluate(cxt, e).is_integer());
+}
+
+
+// The profile records each evaluation and its steps.
+void
+test_profile()
+{
+  Symbol_table syms;
+  fe::Context cxt(syms);
+  cxt.profile_evaluation(true);
+  evaluate(cxt, make_sum(cxt, 4));
+  evaluate(cxt, make_sum(cxt, 2));
+
+  std::size_t calls = 0;
+  std::size_t steps = 0;
+  for (auto const& r : cxt.evaluation_profile()) {
+    calls += r.second.calls;
+    steps += r.second.steps;
+  }
+  assert(calls == 2);
+  assert(steps == 31 + 7);
+}
+
+
+int
+main()
+{
+  test_steps();
+  test_depth();
+  test_unbounded();
+  test_profile();
+}
@@ -0,0 +1,103 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#include "translate.hpp"
+
+#include <codegen/generator.hpp>
+
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Metadata.h>
+#include <llvm/IR/Module.h>
+
+#include <cstdint>
+
+
+// Returns the loop identifier of the back edge of the loop in f.
+llvm::MDNode*
+get_loop_id(llvm::Function& f)
+{
+  llvm::MDNode* id = nullptr;
+  for (llvm::BasicBlock& b : f) {
+    auto* term = b.getTerminator();
+    if (!term)
+      continue;
+    if (llvm::MDNode* md = term->getMetadata(llvm::LLVMContext::MD_loop)) {
+      assert(!id);
+      id = md;
+    }
+  }
+  assert(id);
+  return id;
+}
+
+
+// Returns the value of the named property of the loop, or 0 if the
+// property is not given.
+std::int64_t
+get_loop_hint(llvm::MDNode* id, char const* name)
+{
+  for (unsigned i = 1; i < id->getNumOperands(); ++i) {
+    llvm::MDNode* prop = llvm::cast<llvm::MDNode>(id->getOperand(i));
+    llvm::MDString* str = llvm::cast<llvm::MDString>(prop->getOperand(0));
+    if (str->getString() == name) {
+      auto* md = llvm::cast<llvm::ConstantAsMetadata>(prop->getOperand(1));
+      return llvm::cast<llvm::ConstantInt>(md->getValue())->getSExtValue();
+    }
+  }
+  return 0;
+}
+
+
+// Each loop has a distinct, self-referential identifier that carries
+// its hints.
+void
+test_hints(char const* dir)
+{
+  Symbol_table syms;
+  fe::Context cxt(syms);
+  bool ok = translate(cxt, read_program(dir, "loop-hints-1.banjo"));
+  assert(ok);
+
+  ll::Generator gen(cxt);
+  llvm::Module* mod = gen(cxt.translation_unit());
+
+  llvm::MDNode* sum = get_loop_id(*mod->getFunction("sum"));
+  assert(sum->getOperand(0) == sum);
+  assert(get_loop_hint(sum, "llvm.loop.vectorize.enable") == 1);
+  assert(get_loop_hint(sum, "llvm.loop.vectorize.width") == 4);
+  assert(get_loop_hint(sum, "llvm.loop.unroll.count") == 2);
+
+  llvm::MDNode* count = get_loop_id(*mod->getFunction("count"));
+  assert(count != sum);
+  assert(get_loop_hint(count, "llvm.loop.vectorize.width") == 0);
+  assert(get_loop_hint(count, "llvm.loop.unroll.count") == 8);
+  delete mod;
+}
+
+
+// Unknown hints, and hints that are not positive ints, are rejected.
+void
+test_invalid()
+{
+  char const* progs[] {
+    "def f() { while [interleave=2] (true) { } }",
+    "def f() { while [unroll=0] (true) { } }",
+    "def f() { while [unroll=2147483648] (true) { } }",
+  };
+  for (char const* p : progs) {
+    Symbol_table syms;
+    fe::Context cxt(syms);
+    bool ok = translate(cxt, p);
+    assert(!ok);
+  }
+}
+
+
+int
+main(int argc, char* argv[])
+{
+  assert(argc == 2);
+  test_hints(argv[1]);
+  test_invalid();
+}
@@ -0,0 +1,88 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#include "translate.hpp"
+
+#include <compiler/printer.hpp>
+
+#include <iomanip>
+#include <sstream>
+
+
+// Returns the printed form of the translation unit.
+String
+print(Context& cxt)
+{
+  std::ostringstream ss;
+  ss << cxt.translation_unit();
+  return ss.str();
+}
+
+
+// Output is written exactly as formatted, including output that spans
+// several blocks, deep indentation, and numbers, which are formatted
+// with the flags of the stream.
+void
+test_output()
+{
+  std::ostringstream ss;
+  ss << std::hex;
+  String expect;
+  {
+    Printer p(ss);
+    for (int i = 0; i < 10000; ++i) {
+      p.token("x");
+      p.space();
+      p.token(i);
+      p.token(';');
+      p.newline();
+
+      std::ostringstream num;
+      num << std::hex << i;
+      expect += "x " + num.str() + ";\n";
+    }
+    for (int i = 0; i < 40; ++i)
+      p.newline_and_indent();
+    p.token('}');
+    for (int i = 0; i < 40; ++i)
+      expect += '\n' + String(2 * (i + 1), ' ');
+    expect += '}';
+  }
+  assert(expect.size() > (1 << 16));
+  assert(ss.str() == expect);
+}
+
+
+// Printing a translated program gives a program that prints the same,
+// byte for byte.
+void
+test_round_trip()
+{
+  std::stringstream src;
+  for (int i = 0; i < 4000; ++i) {
+    src << "var v" << i << " : int = " << i << " + 2 * 3;\n";
+    src << "var w" << i << " : int = v" << i << ";\n";
+  }
+
+  Symbol_table syms1;
+  fe::Context cxt1(syms1);
+  bool ok = translate(cxt1, src.str());
+  assert(ok);
+  String first = print(cxt1);
+  assert(first.size() > (1 << 16));
+
+  Symbol_table syms2;
+  fe::Context cxt2(syms2);
+  ok = translate(cxt2, first);
+  assert(ok);
+  String second = print(cxt2);
+  assert(first == second);
+}
+
+
+int
+main()
+{
+  test_output();
+  test_round_trip();
+}
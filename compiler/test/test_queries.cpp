@@ -0,0 +1,161 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#include "translate.hpp"
+
+#include <banjo/query.hpp>
+
+#include <cassert>
+
+
+char const* program =
+  "var a : int = 1;\n"
+  "var b : int = a;\n"
+  "var c : int = 3;\n";
+
+
+// A translated program whose type queries are counted. The type of b
+// is computed from the type of a, and the type of a from itself when
+// cyclic is set.
+struct Fixture
+{
+  Fixture()
+    : cxt(syms)
+  {
+    bool ok = translate(cxt, program);
+    assert(ok);
+    a = find_declaration(cxt, "a");
+    b = find_declaration(cxt, "b");
+    c = find_declaration(cxt, "c");
+    assert(a && b && c);
+
+    Query_engine& q = cxt.queries();
+    q.clear();
+    q.provide(type_query, [this](Term& t) -> Query_result {
+      ++calls;
+      Typed_decl& d = cast<Typed_decl>(t);
+      if (&d == b || (&d == a && cyclic))
+        type_of(cxt, *a);
+      return {&d.type()};
+    });
+  }
+
+  Symbol_table syms;
+  fe::Context  cxt;
+  Decl*        a;
+  Decl*        b;
+  Decl*        c;
+  int          calls  = 0;
+  bool         cyclic = false;
+};
+
+
+// Results are computed once, along with the results they use.
+void
+test_memoize()
+{
+  Fixture f;
+  Query_engine& q = f.cxt.queries();
+  Query_stats s = q.stats();
+
+  type_of(f.cxt, *f.b);
+  assert(f.calls == 2);
+  assert(q.is_cached(type_query, *f.a));
+  assert(q.is_cached(type_query, *f.b));
+
+  type_of(f.cxt, *f.b);
+  type_of(f.cxt, *f.a);
+  assert(f.calls == 2);
+  assert(q.stats().misses == s.misses + 2);
+  assert(q.stats().hits == s.hits + 2);
+}
+
+
+// Invalidating a term discards the results that used it, but not the
+// results that it used.
+void
+test_invalidate()
+{
+  Fixture f;
+  Query_engine& q = f.cxt.queries();
+  type_of(f.cxt, *f.b);
+  type_of(f.cxt, *f.c);
+  Query_stats s = q.stats();
+
+  q.invalidate(*f.b);
+  assert(!q.is_cached(type_query, *f.b));
+  assert(q.is_cached(type_query, *f.a));
+
+  type_of(f.cxt, *f.b);
+  assert(f.calls == 4);
+
+  q.invalidate(*f.a);
+  assert(!q.is_cached(type_query, *f.a));
+  assert(!q.is_cached(type_query, *f.b));
+  assert(q.is_cached(type_query, *f.c));
+  assert(q.stats().invalidations == s.invalidations + 3);
+
+  // Recomputing b recomputes a, and b is again a user of a.
+  type_of(f.cxt, *f.b);
+  assert(f.calls == 6);
+  q.invalidate(*f.a);
+  assert(!q.is_cached(type_query, *f.b));
+}
+
+
+// A query that depends on itself is diagnosed, and leaves no result.
+void
+test_cycle()
+{
+  Fixture f;
+  Query_engine& q = f.cxt.queries();
+  f.cyclic = true;
+  for (int i = 0; i < 2; ++i) {
+    int errs = error_count();
+    bool thrown = false;
+    try {
+      type_of(f.cxt, *f.b);
+    } catch (Translation_error&) {
+      thrown = true;
+    }
+    assert(thrown);
+    assert(error_count() > errs);
+    assert(!q.is_cached(type_query, *f.a));
+    assert(!q.is_cached(type_query, *f.b));
+    assert(q.active.empty());
+  }
+}
+
+
+// Elaborating a reference to a declaration queries its type, so the
+// initializer of b depends on the type of a.
+void
+test_references()
+{
+  Symbol_table syms;
+  fe::Context cxt(syms);
+  bool ok = translate(cxt, program);
+  assert(ok);
+  Decl* a = find_declaration(cxt, "a");
+  Decl* b = find_declaration(cxt, "b");
+  Decl* c = find_declaration(cxt, "c");
+
+  Query_engine& q = cxt.queries();
+  assert(q.is_cached(body_query, *b));
+  assert(q.is_cached(body_query, *c));
+
+  q.invalidate(*a);
+  assert(!q.is_cached(body_query, *b));
+  assert(q.is_cached(type_query, *b));
+  assert(q.is_cached(body_query, *c));
+}
+
+
+int
+main()
+{
+  test_memoize();
+  test_invalidate();
+  test_cycle();
+  test_references();
+}
@@ -0,0 +1,183 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#include "translate.hpp"
+
+#include <banjo/serialization.hpp>
+
+#include <codegen/generator.hpp>
+
+#include <llvm/IR/Module.h>
+
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+
+using Bytes = std::vector<char>;
+
+
+Bytes
+read_file(char const* path)
+{
+  std::ifstream is(path, std::ios::binary);
+  return Bytes(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+}
+
+
+void
+write_file(char const* path, Bytes const& bs)
+{
+  std::ofstream os(path, std::ios::binary);
+  os.write(bs.data(), bs.size());
+}
+
+
+// Write a translation unit that defines x, f, and g.
+void
+write_library(char const* path)
+{
+  Symbol_table syms;
+  fe::Context cxt(syms);
+  bool ok = translate(cxt,
+    "var x : int = 5;\n"
+    "def f(n : int) -> int { return n + x; }\n"
+    "def g() -> int { return f(1); }\n");
+  assert(ok);
+  Ast_writer write;
+  ok = write(cxt.translation_unit(), path);
+  assert(ok);
+}
+
+
+// Imported variables and functions are external declarations, and only
+// the declarations that are used are read.
+void
+test_import(char const* path)
+{
+  Symbol_table syms;
+  fe::Context cxt(syms);
+  bool ok = cxt.import(path);
+  assert(ok);
+
+  ok = translate(cxt, "def h() -> int { return f(2) + x; }\n");
+  assert(ok);
+  assert(cxt.imported_declarations().size() == 2);
+
+  Overload_set* fs = cxt.global_scope().lookup(cxt.get_id("f"));
+  assert(fs && fs->size() == 1);
+  Function_decl& f = cast<Function_decl>(fs->front());
+  assert(f.specifiers() & extern_spec);
+  assert(is<Empty_def>(f.definition()));
+  assert(f.parameters().size() == 1);
+
+  // Imported declarations are not part of the translation unit.
+  assert(find_declaration(cxt, "h"));
+  assert(!find_declaration(cxt, "f"));
+  assert(!find_declaration(cxt, "x"));
+
+  // They are declared, but not defined, in the generated module.
+  ll::Generator gen(cxt);
+  llvm::Module* mod = gen(cxt.translation_unit());
+  assert(mod->getFunction("f")->isDeclaration());
+  assert(mod->getGlobalVariable("x")->isDeclaration());
+  assert(!mod->getFunction("h")->isDeclaration());
+  assert(!mod->getFunction("g"));
+  delete mod;
+}
+
+
+// Integer literals keep their full width.
+void
+test_integers(char const* path)
+{
+  llvm::APSInt n(llvm::APInt(128, 1).shl(100) + 3, false);
+  std::uint32_t id;
+  {
+    Symbol_table syms;
+    fe::Context cxt(syms);
+    Type& t = cxt.get_integer_type(true, 128);
+    Integer_expr& e = cxt.get_integer(t, Integer(n));
+    Ast_writer write;
+    id = write.node(e);
+    bool ok = write(cxt.translation_unit(), path);
+    assert(ok);
+  }
+  Symbol_table syms;
+  fe::Context cxt(syms);
+  Ast_reader read(cxt, path);
+  assert(read);
+  Integer_expr& e = read.get<Integer_expr>(id);
+  llvm::APSInt const& m = e.value().impl();
+  assert(m.getBitWidth() == 128);
+  assert(m == n);
+}
+
+
+// Tables that leave the file are rejected when the file is opened,
+// and malformed records are rejected when they are read.
+void
+test_malformed(char const* path, char const* bad)
+{
+  Bytes bs = read_file(path);
+  Ast_header h;
+  std::memcpy(&h, bs.data(), sizeof(h));
+
+  {
+    Ast_header t = h;
+    t.index_offset = bs.size();
+    Bytes cs = bs;
+    std::memcpy(cs.data(), &t, sizeof(t));
+    write_file(bad, cs);
+    Symbol_table syms;
+    fe::Context cxt(syms);
+    assert(!Ast_reader(cxt, bad));
+  }
+  {
+    Ast_header t = h;
+    t.root = t.nodes;
+    Bytes cs = bs;
+    std::memcpy(cs.data(), &t, sizeof(t));
+    write_file(bad, cs);
+    Symbol_table syms;
+    fe::Context cxt(syms);
+    assert(!Ast_reader(cxt, bad));
+  }
+  {
+    Bytes cs(bs.begin(), bs.begin() + h.export_offset);
+    write_file(bad, cs);
+    Symbol_table syms;
+    fe::Context cxt(syms);
+    assert(!Ast_reader(cxt, bad));
+  }
+
+  // Corrupt the kind of the first exported declaration.
+  Bytes cs = bs;
+  std::uint32_t* words = (std::uint32_t*)cs.data();
+  std::uint32_t node = words[h.export_offset / 4 + 1];
+  std::uint32_t off = words[h.index_offset / 4 + node];
+  words[h.node_offset / 4 + off] = -1;
+  write_file(bad, cs);
+
+  Symbol_table syms;
+  fe::Context cxt(syms);
+  Ast_reader read(cxt, bad);
+  assert(read);
+  try {
+    read.lookup("x");
+    assert(false);
+  } catch (Import_error&) { }
+}
+
+
+int
+main(int argc, char* argv[])
+{
+  char const* path = "test-serialize.ast";
+  char const* bad = "test-serialize-bad.ast";
+  write_library(path);
+  test_import(path);
+  test_malformed(path, bad);
+  test_integers(path);
+}
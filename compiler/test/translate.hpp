@@ -0,0 +1,85 @@
+// Copyright (c) 2015-2016 Andrew Sutton
+// All rights reserved
+
+#ifndef TEST_TRANSLATE_HPP
+#define TEST_TRANSLATE_HPP
+
+// Support for tests that translate small programs in process.
+
+#include <compiler/context.hpp>
+#include <compiler/lexer.hpp>
+#include <compiler/parser.hpp>
+#include <compiler/elab-declarations.hpp>
+#include <compiler/elab-expressions.hpp>
+#include <compiler/elab-constants.hpp>
+
+#include <banjo/ast.hpp>
+
+#include <lingo/file.hpp>
+#include <lingo/error.hpp>
+
+#include <cassert>
+#include <fstream>
+#include <iterator>
+
+
+using namespace lingo;
+using namespace banjo;
+
+
+// Lex, parse and elaborate the program in the context. Constants are
+// folded when fold is true. Returns false if translation fails.
+inline bool
+translate(fe::Context& cxt, String const& text, bool fold = false)
+{
+  int errs = error_count();
+  try {
+    Buffer buf = text;
+    Character_stream cs = buf;
+    Token_stream ts;
+    fe::Lexer lex(cxt, cs, ts);
+    lex();
+    if (error_count() != errs)
+      return false;
+
+    fe::Parser parse(cxt, ts);
+    parse();
+    fe::elaborate<fe::Elaborate_declarations>(parse);
+    fe::elaborate<fe::Elaborate_expressions>(parse);
+    if (fold)
+      fe::elaborate<fe::Elaborate_constants>(parse);
+  } catch (Translation_error&) {
+    return false;
+  }
+  return error_count() == errs;
+}
+
+
+// Returns the text of the named file in the directory.
+inline String
+read_program(char const* dir, char const* name)
+{
+  std::ifstream is(String(dir) + '/' + name);
+  assert(is);
+  return String(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+}
+
+
+// Returns the declaration of the name in the translation unit, or
+// nullptr if there is none.
+inline Decl*
+find_declaration(Context& cxt, char const* name)
+{
+  for (Stmt& s : cxt.translation_unit().statements()) {
+    if (Declaration_stmt* ds = as<Declaration_stmt>(&s)) {
+      Decl& d = ds->declaration();
+      Simple_id const* id = as<Simple_id>(&d.name());
+      if (id && id->symbol().spelling() == name)
+        return &d;
+    }
+  }
+  return nullptr;
+}
+
+
+#endif